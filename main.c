@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
 #ifdef __MINGW32__
     #include <SDL2/SDL.h>
@@ -16,6 +17,50 @@
 #define GRID_SIZE 20
 #define GRID_WIDTH (WINDOW_WIDTH / GRID_SIZE)
 #define GRID_HEIGHT ((WINDOW_HEIGHT - 100) / GRID_SIZE)  // 留出分数显示区域
+#define GRID_CELLS (GRID_WIDTH * GRID_HEIGHT)
+
+// 回放缓冲区：每帧记录一个增量，容量必须是2的幂
+#define REWIND_CAPACITY 8192
+#define REWIND_MASK (REWIND_CAPACITY - 1)
+#define REWIND_SCRUB_TICKS 100   // PageUp/PageDown 一次跳转的帧数
+
+// 线程间通信
+#define INPUT_QUEUE_SIZE 64      // 输入队列容量，必须是2的幂
+#define SNAPSHOT_DIRTY 0x4       // 三缓冲中间槽标志：有尚未被读取的新快照
+
+// 紧凑蛇身编码
+#define PACKED_CAPACITY 1024     // 最大节数，必须是2的幂且不小于 GRID_CELLS
+#define PACKED_MASK (PACKED_CAPACITY - 1)
+#define PACKED_WORDS (PACKED_CAPACITY / 32)  // 每个64位字存32个2位方向
+#define PACKED_HEADER_BYTES 4    // 序列化头部：尾部格子 + 节数
+#define PACKED_WRAP_BIAS_X (GRID_WIDTH * (PACKED_CAPACITY / GRID_WIDTH + 1))    // 解码时保证坐标为正
+#define PACKED_WRAP_BIAS_Y (GRID_HEIGHT * (PACKED_CAPACITY / GRID_HEIGHT + 1))
+#define PACKED_DECODE_SLOTS (PACKED_CAPACITY + 8)     // 解码缓冲：两段的首尾各可能多展开3节
+#define PACKED_LANES 0x0001000100010001ull             // 64位字中4个16位通道各取最低位
+#define PACKED_SPREAD 0x0000040010004001ull            // 乘以一个字节后，第 j 个方向码落在第 j 个通道的最低两位
+#define PACKED_BENCH_SEGMENTS 2000000  // 基准测试中每组的总节数
+#define PACKED_BENCH_MOVES 16          // 基准测试中每个状态的移动次数
+#define MALLOC_OVERHEAD 16       // 估算的每次 malloc 额外开销（字节）
+
+// 离屏视频导出
+#define EXPORT_FPS 10            // 导出视频的帧率，每帧对应一个游戏节拍
+#define EXPORT_DEFAULT_FRAMES 600
+#define EXPORT_MAX_THREADS 64
+#define EXPORT_FRAME_BYTES (WINDOW_WIDTH * WINDOW_HEIGHT * 3 / 2)  // YUV420 一帧
+
+// 遥测统计
+#define TELEMETRY_MAX_SLOTS 64        // 最多同时统计的线程数
+#define TELEMETRY_CACHE_LINE 64       // 每个槽按缓存行对齐，避免线程间伪共享
+#define TELEMETRY_FOOD_BUCKETS 256    // 吃到食物的间隔帧数，最后一桶包含更大的值
+#define TELEMETRY_SCORE_BUCKETS 128   // 最终分数 / 10
+#define TELEMETRY_LENGTH_STEP 16      // 最终长度的桶宽
+#define TELEMETRY_LENGTH_BUCKETS (GRID_CELLS / TELEMETRY_LENGTH_STEP + 1)
+#define TELEMETRY_EXPORT_INTERVAL 5000  // 定期写出快照的间隔（毫秒）
+#define TELEMETRY_BENCH_ROUNDS 5      // 基准测试中开启/关闭各运行的轮数
+
+// 文字纹理缓存
+#define TEXT_CACHE_SIZE 16       // 同时缓存的文字条数，超出时替换最久未使用的
+#define TEXT_CACHE_MAX_LEN 128   // 可缓存文字的最大字节数
 
 // 颜色定义 (RGBA)
 #define COLOR_BACKGROUND 0x1E, 0x1E, 0x1E, 0xFF
@@ -50,11 +95,71 @@ typedef struct {
     int pending_growth;  // 待增长的长度
 } Snake;
 
+// 紧凑蛇身的工作结构：尾部格子 + 每节2位方向，固定264字节
+// dirs[i] 是从尾部数第 i 节到第 i+1 节的方向，存放在环形位数组中，
+// 因此头部增长和尾部移除都是 O(1)。
+// 大量保存状态时不要直接存这个结构，而是用 packed_serialize 把每个状态
+// 写成变长记录（4 + (length-1)/4 字节）连续存放，需要时再 packed_deserialize
+typedef struct {
+    Uint64 words[PACKED_WORDS];
+    Uint16 tail;        // 尾部格子
+    Uint16 head;        // 头部格子（冗余保存，便于 O(1) 增长）
+    Uint16 start;       // dirs[0] 在环形位数组中的位置
+    Uint16 length;      // 节数
+} PackedSnake;
+
+_Static_assert(PACKED_CAPACITY >= GRID_CELLS, "PACKED_CAPACITY 必须不小于格子总数");
+
+// 死因
+typedef enum {
+    DEATH_SELF,         // 撞到自己
+    DEATH_WALL,         // 撞墙（棋盘四边相通，目前不会发生，保留以便关闭穿墙）
+    DEATH_BOARD_FULL,   // 蛇身占满棋盘，无处生成食物
+    DEATH_CAUSES
+} DeathCause;
+
+// 遥测槽：每个线程独占一个，只有该线程写入，合并时才被其他线程读取
+typedef struct {
+    _Alignas(TELEMETRY_CACHE_LINE) Uint64 steps;
+    Uint64 games;
+    // 计数器都用64位：合并时最多64个槽相加，32位的热力图几小时就会溢出
+    Uint64 head_heatmap[GRID_CELLS];                // 蛇头经过每个格子的次数
+    Uint64 food_ticks[TELEMETRY_FOOD_BUCKETS];      // 相邻两次吃到食物之间的帧数
+    Uint64 deaths[DEATH_CAUSES];
+    Uint64 scores[TELEMETRY_SCORE_BUCKETS];
+    Uint64 lengths[TELEMETRY_LENGTH_BUCKETS];
+} TelemetrySlot;
+
 // 食物结构体
 typedef struct {
     int x, y;
 } Food;
 
+// 单帧增量（8字节）：只记录这一帧改变了什么，而不是整条蛇的快照
+// 格子用 y * GRID_WIDTH + x 编码；吃掉的食物一定在新头部的位置，无需单独记录
+typedef struct {
+    Uint16 head;        // 新增的头部格子
+    Uint16 tail;        // 被移除的尾部格子（TICK_GREW 时无效）
+    Uint16 food;        // 新生成的食物格子（TICK_ATE 时有效）
+    Uint8 flags;        // TICK_* 标志，游戏结束时高位保存死因
+    Uint8 food_gap;     // 本帧之前的 ticks_since_food（超出的值截断），回退时恢复遥测
+} TickDelta;
+
+#define TICK_GREW 0x01       // 本帧蛇身增长，尾部未移除
+#define TICK_ATE 0x02        // 本帧吃到食物：分数+10，待增长+2
+#define TICK_GAME_OVER 0x04  // 本帧导致游戏结束
+#define TICK_CAUSE_SHIFT 3   // 死因（DeathCause）存放在 flags 的第3位起
+
+_Static_assert(TELEMETRY_FOOD_BUCKETS <= 256, "food_gap 只有8位");
+
+// 增量环形缓冲区：内存固定为 REWIND_CAPACITY * sizeof(TickDelta)
+typedef struct {
+    TickDelta deltas[REWIND_CAPACITY];
+    Uint32 pos;     // 下一条写入位置（单调递增，取模后使用）
+    Uint32 count;   // pos 之前可回退的帧数
+    Uint32 redo;    // pos 之后可重做的帧数（回退后未被新帧覆盖）
+} RewindBuffer;
+
 // 游戏状态
 typedef enum {
     GAME_START,
@@ -63,11 +168,82 @@ typedef enum {
     GAME_OVER
 } GameState;
 
+// 输入命令：主线程把按键翻译成命令，由模拟线程执行
+typedef enum {
+    CMD_TURN_UP,
+    CMD_TURN_DOWN,
+    CMD_TURN_LEFT,
+    CMD_TURN_RIGHT,
+    CMD_SPACE,          // 开始/暂停/继续/重新开始
+    CMD_CONFIRM,        // Enter：开始/重新开始
+    CMD_RESTART,        // R：游戏结束后重新开始
+    CMD_REWIND,         // BACKSPACE：回退一帧
+    CMD_SCRUB_BACK,     // PgUp
+    CMD_SCRUB_FORWARD   // PgDn
+} InputCommand;
+
+typedef struct {
+    InputCommand command;
+    Uint64 stamp;       // 按键被读取时的性能计数器值
+} InputEvent;
+
+// 单生产者（主线程）单消费者（模拟线程）无锁队列
+typedef struct {
+    InputEvent events[INPUT_QUEUE_SIZE];
+    SDL_atomic_t head;  // 下一条写入位置，只由生产者修改
+    SDL_atomic_t tail;  // 下一条读取位置，只由消费者修改
+} InputQueue;
+
+// 渲染快照：模拟线程发布后不再修改，渲染只读取快照而不访问蛇身链表
+typedef struct {
+    Uint16 cells[GRID_CELLS];   // 蛇身格子，cells[0] 为头部
+    int length;
+    Food food;
+    GameState state;
+    int score;
+    int high_score;
+    int speed;
+    Uint32 rewind_redo;
+    Uint64 input_stamp;         // 该快照已处理的最后一条输入的时间戳
+} RenderSnapshot;
+
+// 三缓冲：模拟线程和渲染线程各持有一个槽，第三个槽通过原子交换传递
+typedef struct {
+    RenderSnapshot slots[3];
+    SDL_atomic_t middle;        // 中间槽下标，可能带 SNAPSHOT_DIRTY
+    int back;                   // 模拟线程正在写的槽
+    int front;                  // 渲染线程正在读的槽
+} SnapshotBuffer;
+
+// 帧时统计：抖动由模拟线程写，延迟由渲染线程写
+typedef struct {
+    Uint64 last_tick;           // 上一帧移动的时间（0 表示暂停后重新计时）
+    unsigned long ticks;
+    double jitter_sum;          // |实际间隔 - speed| 之和（毫秒）
+    double jitter_max;
+
+    Uint64 last_input_stamp;
+    unsigned long inputs;
+    double latency_sum;         // 输入到 SDL_RenderPresent 返回的时间之和（毫秒）
+    double latency_max;
+} FrameStats;
+
+// 文字纹理缓存条目
+typedef struct {
+    char text[TEXT_CACHE_MAX_LEN];
+    SDL_Color color;
+    SDL_Texture* texture;       // NULL 表示空条目
+    int w, h;
+    Uint32 last_used;
+} TextCacheEntry;
+
 // 游戏主结构
 typedef struct {
     SDL_Window* window;
     SDL_Renderer* renderer;
     TTF_Font* font;
+    TextCacheEntry text_cache[TEXT_CACHE_SIZE];
+    Uint32 text_clock;          // 每次绘制文字加一，用于找出最久未使用的缓存
 
     Snake snake;
     Food food;
@@ -76,20 +252,74 @@ typedef struct {
     int score;
     int high_score;
     int speed;          // 移动速度（毫秒/帧）
+    Uint32 rng_state;   // 每局独立的随机数状态，相同种子得到相同对局
+    TelemetrySlot* telemetry;       // 本线程的遥测槽，NULL 表示不统计
+    const char* telemetry_path;     // 遥测快照输出路径
+    int ticks_since_food;
+    DeathCause death_cause;     // 最近一次游戏结束的原因
     Uint32 last_move_time;
     bool running;
+
+    RewindBuffer rewind;
+
+    // 模拟线程
+    bool threaded;              // false 时在主线程中模拟（用于对比）
+    int render_load;            // 每帧额外的渲染耗时（毫秒），用于测试
+    SDL_Thread* sim_thread;
+    SDL_atomic_t sim_running;
+    Uint64 last_input_stamp;    // 模拟线程最后处理的输入
+    Uint64 last_pushed_stamp;   // 主线程最后写入队列的输入
+    InputQueue input;
+    SnapshotBuffer snapshots;
+    const RenderSnapshot* view; // 当前帧渲染使用的快照
+    FrameStats stats;
 } Game;
 
+// 视频导出任务：工作线程通过 next_game 领取对局
+typedef struct {
+    int games;
+    int frames;             // 每局最多导出的帧数
+    int threads;
+    Uint32 seed;
+    const char* dir;
+    const char* telemetry_path;
+    SDL_atomic_t next_game;
+    SDL_atomic_t finished;  // 已结束的工作线程数
+    SDL_mutex* font_lock;   // 串行化字体的打开和关闭
+} ExportJob;
+
+// 导出线程：帧缓冲在线程内复用，不按帧分配
+typedef struct {
+    ExportJob* job;
+    int index;
+    SDL_Surface* surface;       // 离屏渲染目标
+    Uint8* yuv;                 // YUV420 输出缓冲
+    RenderSnapshot* snapshot;
+    unsigned long frames;
+    double seconds;
+} ExportWorker;
+
+// 所有线程的遥测槽
+typedef struct {
+    TelemetrySlot slots[TELEMETRY_MAX_SLOTS];
+    SDL_atomic_t used;
+} TelemetryRegistry;
+
+static TelemetryRegistry telemetry_registry;
+
 // ===================== 函数声明 =====================
 // 初始化函数
 bool init_game(Game* game);
 bool init_graphics(Game* game);
 void init_snake(Game* game);
+void free_snake_nodes(SnakeNode* node);
 void init_food(Game* game);
 
 // 游戏逻辑函数
 void handle_input(Game* game);
-void update_game(Game* game);
+void apply_input(Game* game, const InputEvent* event);
+bool update_game(Game* game);
+void step_game(Game* game);
 void move_snake(Game* game);
 void check_collisions(Game* game);
 bool check_food_collision(Game* game);
@@ -98,18 +328,77 @@ bool check_wall_collision(Game* game);
 
 // 渲染函数
 void render_game(Game* game);
+void render_scene(Game* game);
 void render_snake(Game* game);
 void render_food(Game* game);
 void render_grid(Game* game);
 void render_ui(Game* game);
 void render_text(Game* game, const char* text, int x, int y, SDL_Color color);
+void text_cache_clear(Game* game);
 
 // 工具函数
 void spawn_food(Game* game);
+int game_rand(Game* game);
+TTF_Font* open_font(void);
 void grow_snake(Game* game);
 void reset_game(Game* game);
 void cleanup(Game* game);
 
+// 回放函数
+void rewind_reset(Game* game);
+void rewind_record(Game* game, int prev_tail, bool grew, int prev_score, int prev_ticks_since_food);
+int rewind_step_back(Game* game, int ticks);
+int rewind_step_forward(Game* game, int ticks);
+void rewind_sync_derived(Game* game);
+void rewind_report(Game* game);
+
+// 紧凑蛇身编码函数
+Direction direction_between(int from_x, int from_y, int to_x, int to_y);
+int cell_step(int cell, Direction dir);
+void packed_init(PackedSnake* ps, int cell);
+void packed_push_head(PackedSnake* ps, Direction dir);
+void packed_pop_tail(PackedSnake* ps);
+void packed_expand_run(const Uint64* words, int begin, int end, Sint16* xs, Sint16* ys);
+int packed_decode(const PackedSnake* ps, Uint16* cells);
+void packed_from_snake(PackedSnake* ps, const Snake* snake);
+int packed_serialize(const PackedSnake* ps, Uint8* out);
+int packed_deserialize(PackedSnake* ps, const Uint8* in);
+void bench_packed(void);
+
+// 视频导出函数
+Direction autopilot_direction(Game* game);
+bool parse_export_args(ExportJob* job, int argc, char* argv[]);
+void write_y4m_frame(FILE* file, SDL_Surface* surface, Uint8* yuv);
+int export_game(ExportWorker* worker, Game* game, int index);
+int export_worker_main(void* data);
+void export_worker_cleanup(ExportWorker* worker, Game* game);
+bool run_export(ExportJob* job);
+
+// 遥测函数
+TelemetrySlot* telemetry_acquire_slot(void);
+void telemetry_record_step(Game* game);
+void telemetry_record_food(Game* game);
+void telemetry_end_buckets(const Game* game, int* score_bucket, int* length_bucket);
+void telemetry_record_death(Game* game, DeathCause cause);
+void telemetry_undo_tick(Game* game, const TickDelta* delta);
+void telemetry_redo_tick(Game* game, const TickDelta* delta);
+void telemetry_merge(TelemetrySlot* merged);
+bool telemetry_write_csv(const char* path);
+void bench_telemetry(int steps);
+
+// 线程函数
+bool input_push(InputQueue* queue, InputCommand command, Uint64 stamp);
+bool input_pop(InputQueue* queue, InputEvent* event);
+void fill_snapshot(Game* game, RenderSnapshot* snap);
+void publish_snapshot(Game* game);
+void acquire_snapshot(Game* game);
+void sim_poll(Game* game);
+int sim_thread_main(void* data);
+void start_simulation(Game* game);
+void stop_simulation(Game* game);
+void parse_args(Game* game, int argc, char* argv[]);
+void print_frame_stats(Game* game);
+
 // ===================== 函数实现 =====================
 
 // 初始化SDL和游戏
@@ -117,6 +406,8 @@ bool init_game(Game* game) {
     game->window = NULL;
     game->renderer = NULL;
     game->font = NULL;
+    memset(game->text_cache, 0, sizeof(game->text_cache));
+    game->text_clock = 0;
     game->snake.head = NULL;
     game->snake.tail = NULL;
     game->state = GAME_START;
@@ -125,6 +416,24 @@ bool init_game(Game* game) {
     game->speed = 150;  // 初始速度：150ms/帧
     game->last_move_time = 0;
     game->running = true;
+    game->telemetry = NULL;
+    game->telemetry_path = NULL;
+    game->ticks_since_food = 0;
+    game->death_cause = DEATH_SELF;
+    game->threaded = true;
+    game->render_load = 0;
+    game->sim_thread = NULL;
+    game->last_input_stamp = 0;
+    game->last_pushed_stamp = 0;
+    SDL_AtomicSet(&game->sim_running, 0);
+    SDL_AtomicSet(&game->input.head, 0);
+    SDL_AtomicSet(&game->input.tail, 0);
+    memset(&game->snapshots, 0, sizeof(game->snapshots));
+    game->snapshots.back = 0;
+    SDL_AtomicSet(&game->snapshots.middle, 1);
+    game->snapshots.front = 2;
+    game->view = &game->snapshots.slots[2];
+    memset(&game->stats, 0, sizeof(game->stats));
 
     // 初始化SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -144,11 +453,14 @@ bool init_game(Game* game) {
     }
 
     // 设置随机种子
-    srand(time(NULL));
+    game->rng_state = (Uint32)time(NULL) | 1;
 
     // 初始化蛇和食物
     init_snake(game);
     init_food(game);
+    rewind_reset(game);
+    rewind_report(game);
+    publish_snapshot(game);
 
     return true;
 }
@@ -182,20 +494,28 @@ bool init_graphics(Game* game) {
         return false;
     }
 
-    // 加载字体 - 使用支持中文的字体
-    game->font = TTF_OpenFont("/mingw64/share/fonts/wqy-microhei/wqy-microhei.ttc", 24);
+    // 加载字体
+    game->font = open_font();
 
-    if (!game->font) {
+    return true;
+}
+
+// 加载字体，依次尝试常见路径，全部失败时返回 NULL（纯图形模式）
+TTF_Font* open_font(void) {
+    // 使用支持中文的字体
+    TTF_Font* font = TTF_OpenFont("/mingw64/share/fonts/wqy-microhei/wqy-microhei.ttc", 24);
+
+    if (!font) {
         // 尝试其他可能的路径
-        game->font = TTF_OpenFont("/ucrt64/share/fonts/wqy-microhei/wqy-microhei.ttc", 24);
-        if (!game->font) {
-            game->font = TTF_OpenFont("C:/Windows/Fonts/msyh.ttc", 24);  // 微软雅黑
-            if (!game->font) {
-                game->font = TTF_OpenFont("C:/Windows/Fonts/simhei.ttf", 24);  // 黑体
-                if (!game->font) {
+        font = TTF_OpenFont("/ucrt64/share/fonts/wqy-microhei/wqy-microhei.ttc", 24);
+        if (!font) {
+            font = TTF_OpenFont("C:/Windows/Fonts/msyh.ttc", 24);  // 微软雅黑
+            if (!font) {
+                font = TTF_OpenFont("C:/Windows/Fonts/simhei.ttf", 24);  // 黑体
+                if (!font) {
                     printf("中文字体加载失败，使用英文字体: %s\n", TTF_GetError());
-                    game->font = TTF_OpenFont("/mingw64/share/fonts/TTF/arial.ttf", 24);    // Arial字体
-                    if (!game->font) {
+                    font = TTF_OpenFont("/mingw64/share/fonts/TTF/arial.ttf", 24);    // Arial字体
+                    if (!font) {
                         printf("字体加载失败: %s\n", TTF_GetError());
                         printf("将使用纯图形模式\n");
                     }
@@ -204,18 +524,22 @@ bool init_graphics(Game* game) {
         }
     }
 
-    return true;
+    return font;
+}
+
+// 释放从 node 开始的整条蛇身链表
+void free_snake_nodes(SnakeNode* node) {
+    while (node) {
+        SnakeNode* next = node->next;
+        free(node);
+        node = next;
+    }
 }
 
 // 初始化蛇
 void init_snake(Game* game) {
     // 清理现有的蛇
-    SnakeNode* current = game->snake.head;
-    while (current) {
-        SnakeNode* next = current->next;
-        free(current);
-        current = next;
-    }
+    free_snake_nodes(game->snake.head);
 
     game->snake.head = NULL;
     game->snake.tail = NULL;
@@ -260,8 +584,8 @@ void spawn_food(Game* game) {
     bool valid_position = false;
 
     while (!valid_position) {
-        game->food.x = rand() % GRID_WIDTH;
-        game->food.y = rand() % GRID_HEIGHT;
+        game->food.x = game_rand(game) % GRID_WIDTH;
+        game->food.y = game_rand(game) % GRID_HEIGHT;
 
         // 检查食物是否与蛇身重叠
         valid_position = true;
@@ -276,11 +600,24 @@ void spawn_food(Game* game) {
     }
 }
 
-// 处理输入
+// 随机数（xorshift32），代替全局的 rand() 以便多线程下复现对局
+int game_rand(Game* game) {
+    Uint32 x = game->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    game->rng_state = x;
+    return (int)(x >> 1);
+}
+
+// 处理输入：在主线程中读取事件，翻译成命令交给模拟线程
 void handle_input(Game* game) {
     SDL_Event event;
 
     while (SDL_PollEvent(&event)) {
+        Uint64 stamp = SDL_GetPerformanceCounter();
+        int command = -1;
+
         switch (event.type) {
             case SDL_QUIT:
                 game->running = false;
@@ -291,47 +628,31 @@ void handle_input(Game* game) {
                     // 方向控制
                     case SDLK_UP:
                     case SDLK_w:
-                        if (game->snake.direction != DIR_DOWN && game->state == GAME_PLAYING)
-                            game->snake.direction = DIR_UP;
+                        command = CMD_TURN_UP;
                         break;
 
                     case SDLK_DOWN:
                     case SDLK_s:
-                        if (game->snake.direction != DIR_UP && game->state == GAME_PLAYING)
-                            game->snake.direction = DIR_DOWN;
+                        command = CMD_TURN_DOWN;
                         break;
 
                     case SDLK_LEFT:
                     case SDLK_a:
-                        if (game->snake.direction != DIR_RIGHT && game->state == GAME_PLAYING)
-                            game->snake.direction = DIR_LEFT;
+                        command = CMD_TURN_LEFT;
                         break;
 
                     case SDLK_RIGHT:
                     case SDLK_d:
-                        if (game->snake.direction != DIR_LEFT && game->state == GAME_PLAYING)
-                            game->snake.direction = DIR_RIGHT;
+                        command = CMD_TURN_RIGHT;
                         break;
 
                     // 游戏控制
                     case SDLK_SPACE:
-                        if (game->state == GAME_START) {
-                            game->state = GAME_PLAYING;
-                        } else if (game->state == GAME_PLAYING) {
-                            game->state = GAME_PAUSED;
-                        } else if (game->state == GAME_PAUSED) {
-                            game->state = GAME_PLAYING;
-                        } else if (game->state == GAME_OVER) {
-                            reset_game(game);
-                        }
+                        command = CMD_SPACE;
                         break;
 
                     case SDLK_RETURN:
-                        if (game->state == GAME_START) {
-                            game->state = GAME_PLAYING;
-                        } else if (game->state == GAME_OVER) {
-                            reset_game(game);
-                        }
+                        command = CMD_CONFIRM;
                         break;
 
                     case SDLK_ESCAPE:
@@ -339,31 +660,154 @@ void handle_input(Game* game) {
                         break;
 
                     case SDLK_r:
-                        if (game->state == GAME_OVER) {
-                            reset_game(game);
-                        }
+                        command = CMD_RESTART;
+                        break;
+
+                    // 回放控制
+                    case SDLK_BACKSPACE:
+                        command = CMD_REWIND;
+                        break;
+
+                    case SDLK_PAGEUP:
+                        command = CMD_SCRUB_BACK;
+                        break;
+
+                    case SDLK_PAGEDOWN:
+                        command = CMD_SCRUB_FORWARD;
                         break;
                 }
                 break;
         }
+
+        if (command >= 0 && input_push(&game->input, (InputCommand)command, stamp)) {
+            game->last_pushed_stamp = stamp;
+        }
+    }
+}
+
+// 执行一条输入命令（在模拟线程中调用）
+void apply_input(Game* game, const InputEvent* event) {
+    game->last_input_stamp = event->stamp;
+
+    switch (event->command) {
+        // 方向控制
+        case CMD_TURN_UP:
+            if (game->snake.direction != DIR_DOWN && game->state == GAME_PLAYING)
+                game->snake.direction = DIR_UP;
+            break;
+
+        case CMD_TURN_DOWN:
+            if (game->snake.direction != DIR_UP && game->state == GAME_PLAYING)
+                game->snake.direction = DIR_DOWN;
+            break;
+
+        case CMD_TURN_LEFT:
+            if (game->snake.direction != DIR_RIGHT && game->state == GAME_PLAYING)
+                game->snake.direction = DIR_LEFT;
+            break;
+
+        case CMD_TURN_RIGHT:
+            if (game->snake.direction != DIR_LEFT && game->state == GAME_PLAYING)
+                game->snake.direction = DIR_RIGHT;
+            break;
+
+        // 游戏控制
+        case CMD_SPACE:
+            if (game->state == GAME_START) {
+                game->state = GAME_PLAYING;
+            } else if (game->state == GAME_PLAYING) {
+                game->state = GAME_PAUSED;
+            } else if (game->state == GAME_PAUSED) {
+                game->state = GAME_PLAYING;
+            } else if (game->state == GAME_OVER) {
+                reset_game(game);
+            }
+            break;
+
+        case CMD_CONFIRM:
+            if (game->state == GAME_START) {
+                game->state = GAME_PLAYING;
+            } else if (game->state == GAME_OVER) {
+                reset_game(game);
+            }
+            break;
+
+        case CMD_RESTART:
+            if (game->state == GAME_OVER) {
+                reset_game(game);
+            }
+            break;
+
+        // 回放控制：回退后进入暂停，按 SPACE 从当前位置继续
+        case CMD_REWIND:
+            if (game->state != GAME_START) {
+                rewind_step_back(game, 1);
+            }
+            break;
+
+        case CMD_SCRUB_BACK:
+            if (game->state != GAME_START) {
+                rewind_step_back(game, REWIND_SCRUB_TICKS);
+            }
+            break;
+
+        case CMD_SCRUB_FORWARD:
+            if (game->state == GAME_PAUSED) {
+                rewind_step_forward(game, REWIND_SCRUB_TICKS);
+            }
+            break;
     }
 }
 
-// 更新游戏逻辑
-void update_game(Game* game) {
+// 更新游戏逻辑，返回本次调用是否移动了蛇
+bool update_game(Game* game) {
     if (game->state != GAME_PLAYING) {
-        return;
+        game->stats.last_tick = 0;
+        return false;
     }
 
     Uint32 current_time = SDL_GetTicks();
+    bool moved = false;
 
     // 控制蛇的移动速度
-    if (current_time - game->last_move_time >= game->speed) {
-        move_snake(game);
-        check_collisions(game);
-        game->last_move_time = current_time;
+    if (current_time - game->last_move_time >= (Uint32)game->speed) {
+        // 统计实际帧间隔与目标间隔的偏差
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (game->stats.last_tick != 0) {
+            double interval = (double)(now - game->stats.last_tick) * 1000.0 / SDL_GetPerformanceFrequency();
+            double jitter = interval > game->speed ? interval - game->speed : game->speed - interval;
+            game->stats.jitter_sum += jitter;
+            if (jitter > game->stats.jitter_max) game->stats.jitter_max = jitter;
+            game->stats.ticks++;
+        }
+        game->stats.last_tick = now;
+
+        step_game(game);
+
+        // 按固定间隔推进，避免误差累积；暂停后或严重落后时重新对齐
+        game->last_move_time += game->speed;
+        if (current_time - game->last_move_time >= (Uint32)game->speed) {
+            game->last_move_time = current_time;
+        }
+        moved = true;
     }
 
+    return moved;
+}
+
+// 推进一帧：移动、碰撞检测、记录回放增量、调整速度
+// 与时间无关，离线模拟（如视频导出）直接调用
+void step_game(Game* game) {
+    int prev_tail = game->snake.tail->y * GRID_WIDTH + game->snake.tail->x;
+    bool grew = game->snake.pending_growth > 0;
+    int prev_score = game->score;
+    int prev_ticks_since_food = game->ticks_since_food;
+
+    move_snake(game);
+    telemetry_record_step(game);
+    check_collisions(game);
+    rewind_record(game, prev_tail, grew, prev_score, prev_ticks_since_food);
+
     // 每得100分增加一次速度（最多到50ms）
     if (game->score >= 100 && game->speed > 50) {
         game->speed = 150 - (game->score / 10);
@@ -419,15 +863,19 @@ void move_snake(Game* game) {
 
 // 检查碰撞
 void check_collisions(Game* game) {
-    // 检查墙壁碰撞
+    // 检查墙壁碰撞（move_snake 已经做了穿墙处理，所以目前不会触发）
     if (check_wall_collision(game)) {
         game->state = GAME_OVER;
+        game->death_cause = DEATH_WALL;
+        telemetry_record_death(game, DEATH_WALL);
         return;
     }
 
     // 检查自身碰撞
     if (check_self_collision(game)) {
         game->state = GAME_OVER;
+        game->death_cause = DEATH_SELF;
+        telemetry_record_death(game, DEATH_SELF);
         return;
     }
 
@@ -435,7 +883,16 @@ void check_collisions(Game* game) {
     if (check_food_collision(game)) {
         game->score += 10;
         game->snake.pending_growth += 2;  // 吃一个食物增长2节
-        spawn_food(game);
+        telemetry_record_food(game);
+
+        // 蛇身占满棋盘时已经没有位置生成食物
+        if (game->snake.length >= GRID_CELLS) {
+            game->state = GAME_OVER;
+            game->death_cause = DEATH_BOARD_FULL;
+            telemetry_record_death(game, DEATH_BOARD_FULL);
+        } else {
+            spawn_food(game);
+        }
 
         // 更新最高分
         if (game->score > game->high_score) {
@@ -483,214 +940,1546 @@ void reset_game(Game* game) {
     game->score = 0;
     game->speed = 150;
     game->state = GAME_PLAYING;
+    game->ticks_since_food = 0;
     init_snake(game);
     spawn_food(game);
+    rewind_reset(game);
 }
 
-// 渲染游戏
-void render_game(Game* game) {
-    // 清屏
-    SDL_SetRenderDrawColor(game->renderer, COLOR_BACKGROUND);
-    SDL_RenderClear(game->renderer);
+// ===================== 回放（时间倒流） =====================
 
-    // 绘制网格
-    render_grid(game);
+// 清空回放缓冲区
+void rewind_reset(Game* game) {
+    game->rewind.pos = 0;
+    game->rewind.count = 0;
+    game->rewind.redo = 0;
+}
 
-    // 绘制蛇
-    render_snake(game);
+// 记录刚执行完的一帧（在 move_snake 和 check_collisions 之后调用）
+void rewind_record(Game* game, int prev_tail, bool grew, int prev_score, int prev_ticks_since_food) {
+    RewindBuffer* rb = &game->rewind;
+    TickDelta* delta = &rb->deltas[rb->pos & REWIND_MASK];
+
+    delta->head = game->snake.head->y * GRID_WIDTH + game->snake.head->x;
+    delta->tail = prev_tail;
+    delta->food = game->food.y * GRID_WIDTH + game->food.x;
+    delta->flags = 0;
+    if (grew) delta->flags |= TICK_GREW;
+    if (game->score != prev_score) delta->flags |= TICK_ATE;
+    if (game->state == GAME_OVER) delta->flags |= TICK_GAME_OVER | (game->death_cause << TICK_CAUSE_SHIFT);
+    delta->food_gap = prev_ticks_since_food < TELEMETRY_FOOD_BUCKETS ? prev_ticks_since_food : TELEMETRY_FOOD_BUCKETS - 1;
+
+    rb->pos++;
+    rb->redo = 0;  // 新的一帧会覆盖回退前的"未来"
+    if (rb->count < REWIND_CAPACITY) {
+        rb->count++;
+    }
+}
 
-    // 绘制食物
-    render_food(game);
+// 回退若干帧，返回实际回退的帧数
+int rewind_step_back(Game* game, int ticks) {
+    RewindBuffer* rb = &game->rewind;
+    Uint64 start = SDL_GetPerformanceCounter();
+    int stepped = 0;
 
-    // 绘制UI
-    render_ui(game);
+    while (stepped < ticks && rb->count > 0) {
+        TickDelta* delta = &rb->deltas[(rb->pos - 1) & REWIND_MASK];
 
-    // 显示渲染结果
-    SDL_RenderPresent(game->renderer);
-}
+        // 先撤销遥测：游戏结束的统计要用撤销前的分数和长度
+        telemetry_undo_tick(game, delta);
 
-// 绘制网格
-void render_grid(Game* game) {
-    SDL_SetRenderDrawColor(game->renderer, COLOR_GRID);
+        // 撤销吃食物：被吃掉的食物就在这一帧的头部位置
+        if (delta->flags & TICK_ATE) {
+            game->score -= 10;
+            game->snake.pending_growth -= 2;
+            game->food.x = delta->head % GRID_WIDTH;
+            game->food.y = delta->head / GRID_WIDTH;
+        }
 
-    // 绘制垂直线
-    for (int x = 0; x <= WINDOW_WIDTH; x += GRID_SIZE) {
-        SDL_RenderDrawLine(game->renderer, x, 0, x, WINDOW_HEIGHT - 100);
+        // 移除这一帧新增的头部
+        SnakeNode* old_head = game->snake.head;
+        game->snake.head = old_head->next;
+        free(old_head);
+
+        // 撤销增长，或者把被移除的尾部接回去
+        if (delta->flags & TICK_GREW) {
+            game->snake.pending_growth++;
+            game->snake.length--;
+        } else {
+            SnakeNode* new_tail = (SnakeNode*)malloc(sizeof(SnakeNode));
+            if (!new_tail) {
+                printf("内存分配失败！\n");
+                exit(1);
+            }
+
+            new_tail->x = delta->tail % GRID_WIDTH;
+            new_tail->y = delta->tail / GRID_WIDTH;
+            new_tail->next = NULL;
+            game->snake.tail->next = new_tail;
+            game->snake.tail = new_tail;
+        }
+
+        rb->pos--;
+        rb->count--;
+        rb->redo++;
+        stepped++;
     }
 
-    // 绘制水平线
-    for (int y = 0; y <= WINDOW_HEIGHT - 100; y += GRID_SIZE) {
-        SDL_RenderDrawLine(game->renderer, 0, y, WINDOW_WIDTH, y);
+    if (stepped > 0) {
+        rewind_sync_derived(game);
+        game->state = GAME_PAUSED;
+
+        double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        printf("回退 %d 帧，耗时 %.3f ms（还可回退 %u 帧）\n", stepped, ms, rb->count);
     }
+
+    return stepped;
 }
 
-// 绘制蛇
-void render_snake(Game* game) {
-    SnakeNode* current = game->snake.head;
-    int index = 0;
+// 重做之前回退的帧，返回实际前进的帧数
+int rewind_step_forward(Game* game, int ticks) {
+    RewindBuffer* rb = &game->rewind;
+    Uint64 start = SDL_GetPerformanceCounter();
+    int stepped = 0;
+    bool game_over = false;
 
-    while (current) {
-        SDL_Rect rect = {
-            current->x * GRID_SIZE,
-            current->y * GRID_SIZE,
-            GRID_SIZE,
-            GRID_SIZE
-        };
+    while (stepped < ticks && rb->redo > 0 && !game_over) {
+        TickDelta* delta = &rb->deltas[rb->pos & REWIND_MASK];
 
-        // 蛇头用不同颜色
-        if (index == 0) {
-            SDL_SetRenderDrawColor(game->renderer, COLOR_SNAKE_HEAD);
+        // 重新插入头部
+        SnakeNode* new_head = (SnakeNode*)malloc(sizeof(SnakeNode));
+        if (!new_head) {
+            printf("内存分配失败！\n");
+            exit(1);
+        }
+
+        new_head->x = delta->head % GRID_WIDTH;
+        new_head->y = delta->head / GRID_WIDTH;
+        new_head->next = game->snake.head;
+        game->snake.head = new_head;
+
+        // 与 move_snake 相同：增长时保留尾部，否则删除尾部
+        if (delta->flags & TICK_GREW) {
+            game->snake.pending_growth--;
+            game->snake.length++;
         } else {
-            SDL_SetRenderDrawColor(game->renderer, COLOR_SNAKE_BODY);
+            SnakeNode* current = game->snake.head;
+            while (current->next != game->snake.tail) {
+                current = current->next;
+            }
+            free(game->snake.tail);
+            current->next = NULL;
+            game->snake.tail = current;
         }
 
-        SDL_RenderFillRect(game->renderer, &rect);
+        if (delta->flags & TICK_ATE) {
+            game->score += 10;
+            game->snake.pending_growth += 2;
+            game->food.x = delta->food % GRID_WIDTH;
+            game->food.y = delta->food / GRID_WIDTH;
 
-        current = current->next;
-        index++;
+            if (game->score > game->high_score) {
+                game->high_score = game->score;
+            }
+        }
+
+        game_over = (delta->flags & TICK_GAME_OVER) != 0;
+        telemetry_redo_tick(game, delta);
+
+        rb->pos++;
+        rb->count++;
+        rb->redo--;
+        stepped++;
     }
-}
 
-// 绘制食物
-void render_food(Game* game) {
-    SDL_Rect rect = {
-        game->food.x * GRID_SIZE,
-        game->food.y * GRID_SIZE,
-        GRID_SIZE,
-        GRID_SIZE
-    };
+    if (stepped > 0) {
+        rewind_sync_derived(game);
+        game->state = game_over ? GAME_OVER : GAME_PAUSED;
 
-    SDL_SetRenderDrawColor(game->renderer, COLOR_FOOD);
-    SDL_RenderFillRect(game->renderer, &rect);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        printf("前进 %d 帧，耗时 %.3f ms（还可前进 %u 帧）\n", stepped, ms, rb->redo);
+    }
 
-    // 绘制食物内部的小矩形，使其看起来更像苹果
-    SDL_SetRenderDrawColor(game->renderer, 0xFF, 0xCC, 0xCC, 0xFF);
-    SDL_Rect inner_rect = {
-        game->food.x * GRID_SIZE + 4,
-        game->food.y * GRID_SIZE + 4,
-        GRID_SIZE - 8,
-        GRID_SIZE - 8
-    };
-    SDL_RenderFillRect(game->renderer, &inner_rect);
+    return stepped;
 }
 
-// 绘制UI
-void render_ui(Game* game) {
-    SDL_Color text_color = {COLOR_TEXT};
+// 方向和速度没有记录在增量里，它们可以由蛇身和分数推出
+void rewind_sync_derived(Game* game) {
+    SnakeNode* head = game->snake.head;
+    game->snake.direction = direction_between(head->next->x, head->next->y, head->x, head->y);
 
-    // 绘制分数区域背景
-    SDL_Rect score_rect = {0, WINDOW_HEIGHT - 100, WINDOW_WIDTH, 100};
-    SDL_SetRenderDrawColor(game->renderer, 0x25, 0x25, 0x25, 0xFF);
-    SDL_RenderFillRect(game->renderer, &score_rect);
+    // 与 update_game 中的加速规则一致
+    game->speed = 150;
+    if (game->score >= 100) {
+        game->speed = 150 - (game->score / 10);
+        if (game->speed < 50) game->speed = 50;
+    }
+}
 
-    // 绘制分数
-    char score_text[100];
-    snprintf(score_text, sizeof(score_text), "分数: %d", game->score);
-    render_text(game, score_text, 20, WINDOW_HEIGHT - 80, text_color);
+// 打印回放缓冲区的内存占用
+void rewind_report(Game* game) {
+    double total_kb = sizeof(game->rewind.deltas) / 1024.0;
+    double slow_ticks = 60000.0 / 150;  // 初始速度下每分钟的帧数
+    double fast_ticks = 60000.0 / 50;   // 最高速度下每分钟的帧数
+
+    printf("回放缓冲区: %d 帧 x %d 字节 = %.0f KB\n",
+           REWIND_CAPACITY, (int)sizeof(TickDelta), total_kb);
+    printf("  每分钟记录 %.1f KB (150ms/帧) ~ %.1f KB (50ms/帧)\n",
+           slow_ticks * sizeof(TickDelta) / 1024.0, fast_ticks * sizeof(TickDelta) / 1024.0);
+    printf("  可回退 %.1f 分钟 (150ms/帧) ~ %.1f 分钟 (50ms/帧)\n",
+           REWIND_CAPACITY / slow_ticks, REWIND_CAPACITY / fast_ticks);
+}
 
-    // 绘制最高分
-    snprintf(score_text, sizeof(score_text), "最高分: %d", game->high_score);
-    render_text(game, score_text, 20, WINDOW_HEIGHT - 50, text_color);
+// ===================== 紧凑蛇身编码 =====================
 
-    // 绘制速度/等级
-    snprintf(score_text, sizeof(score_text), "速度: %d", (160 - game->speed) / 10);
-    render_text(game, score_text, WINDOW_WIDTH - 200, WINDOW_HEIGHT - 80, text_color);
+// 计算两个相邻格子之间的方向（考虑穿墙）
+Direction direction_between(int from_x, int from_y, int to_x, int to_y) {
+    int dx = (to_x - from_x + GRID_WIDTH) % GRID_WIDTH;
+    int dy = (to_y - from_y + GRID_HEIGHT) % GRID_HEIGHT;
 
-    // 绘制操作提示
-    snprintf(score_text, sizeof(score_text), "Tips: 方向键移动 | SPACE 暂停 | R 重新开始 | ESC 退出");
-    render_text(game, score_text, WINDOW_WIDTH/2 - 250, WINDOW_HEIGHT - 30, text_color);
+    if (dx == 1) return DIR_RIGHT;
+    if (dx == GRID_WIDTH - 1) return DIR_LEFT;
+    if (dy == 1) return DIR_DOWN;
+    return DIR_UP;
+}
 
-    // 根据游戏状态显示不同信息
-    switch (game->state) {
-        case GAME_START:
-            render_text(game, "贪吃蛇游戏", WINDOW_WIDTH/2 - 100, 100, text_color);
-            render_text(game, "按 SPACE 或 Enter 开始游戏", WINDOW_WIDTH/2 - 150, 150, text_color);
-            break;
+// 沿某个方向移动一格（考虑穿墙）
+int cell_step(int cell, Direction dir) {
+    int x = cell % GRID_WIDTH;
+    int y = cell / GRID_WIDTH;
 
-        case GAME_PAUSED:
-            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_BLEND);
-            SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 128);
-            SDL_Rect overlay = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
-            SDL_RenderFillRect(game->renderer, &overlay);
-            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_NONE);
+    switch (dir) {
+        case DIR_UP:    y = (y + GRID_HEIGHT - 1) % GRID_HEIGHT; break;
+        case DIR_DOWN:  y = (y + 1) % GRID_HEIGHT; break;
+        case DIR_LEFT:  x = (x + GRID_WIDTH - 1) % GRID_WIDTH; break;
+        case DIR_RIGHT: x = (x + 1) % GRID_WIDTH; break;
+    }
 
-            render_text(game, "游戏暂停", WINDOW_WIDTH/2 - 80, WINDOW_HEIGHT/2 - 50, text_color);
-            render_text(game, "按 SPACE 继续", WINDOW_WIDTH/2 - 100, WINDOW_HEIGHT/2, text_color);
-            break;
+    return y * GRID_WIDTH + x;
+}
 
-        case GAME_OVER:
-            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_BLEND);
-            SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 192);
-            SDL_Rect overlay2 = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
-            SDL_RenderFillRect(game->renderer, &overlay2);
-            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_NONE);
+// 初始化为只有一节的蛇
+void packed_init(PackedSnake* ps, int cell) {
+    memset(ps->words, 0, sizeof(ps->words));
+    ps->tail = cell;
+    ps->head = cell;
+    ps->start = 0;
+    ps->length = 1;
+}
 
-            SDL_Color game_over_color = {COLOR_GAME_OVER};
-            render_text(game, "游戏结束!", WINDOW_WIDTH/2 - 80, WINDOW_HEIGHT/2 - 100, game_over_color);
+// 头部向 dir 前进一格（增长一节）
+void packed_push_head(PackedSnake* ps, Direction dir) {
+    int pos = (ps->start + ps->length - 1) & PACKED_MASK;
+    int shift = (pos % 32) * 2;
 
-            snprintf(score_text, sizeof(score_text), "最终分数: %d", game->score);
-            render_text(game, score_text, WINDOW_WIDTH/2 - 100, WINDOW_HEIGHT/2 - 50, text_color);
+    ps->words[pos / 32] = (ps->words[pos / 32] & ~((Uint64)3 << shift)) | ((Uint64)dir << shift);
+    ps->head = cell_step(ps->head, dir);
+    ps->length++;
+}
 
-            render_text(game, "按 R 或 Enter 重新开始", WINDOW_WIDTH/2 - 150, WINDOW_HEIGHT/2, text_color);
-            render_text(game, "按 ESC 退出游戏", WINDOW_WIDTH/2 - 120, WINDOW_HEIGHT/2 + 40, text_color);
-            break;
+// 移除尾部一节
+void packed_pop_tail(PackedSnake* ps) {
+    int shift = (ps->start % 32) * 2;
+    Direction dir = (Direction)((ps->words[ps->start / 32] >> shift) & 3);
 
-        case GAME_PLAYING:
-            // 游戏中不显示额外信息
-            break;
-    }
+    ps->tail = cell_step(ps->tail, dir);
+    ps->start = (ps->start + 1) & PACKED_MASK;
+    ps->length--;
 }
 
-// 渲染文本
-void render_text(Game* game, const char* text, int x, int y, SDL_Color color) {
-    if (!game->font) {
-        // 如果没有字体，绘制一个简单的矩形作为占位符
-        SDL_Rect rect = {x, y, strlen(text) * 10, 20};
-        SDL_SetRenderDrawColor(game->renderer, color.r, color.g, color.b, 255);
-        SDL_RenderDrawRect(game->renderer, &rect);
-        return;
+// 展开环形位数组中 [begin, end) 的方向为坐标增量，不跨越回绕点
+// 每次从64位字中取一个字节（4节），用乘法把4个2位方向码分散到4个16位通道，
+// 再用位运算一次算出4节的 dx/dy，不查表、不逐节移位。
+// 输出从 begin 所在的4节组开头写起，即前 begin % 4 个是多余的
+void packed_expand_run(const Uint64* words, int begin, int end, Sint16* xs, Sint16* ys) {
+    for (int group = begin / 4; group < (end + 3) / 4; group++) {
+        Uint64 codes = ((words[group / 8] >> (group % 8 * 8)) & 0xFF) * PACKED_SPREAD;
+        Uint64 sign = codes & PACKED_LANES;                     // 低位：正方向（DOWN/RIGHT）
+        Uint64 horizontal = ((codes >> 1) & PACKED_LANES) * 0xFFFF;  // 高位：水平方向
+        Uint64 step = ~(sign * 0xFFFE);                         // 每个通道为 +1 或 -1
+        Uint64 dx = SDL_SwapLE64(step & horizontal);
+        Uint64 dy = SDL_SwapLE64(step & ~horizontal);
+
+        memcpy(xs, &dx, sizeof(dx));
+        memcpy(ys, &dy, sizeof(dy));
+        xs += 4;
+        ys += 4;
     }
+}
 
-    // !Error: 原来失败的方案，没有使用 utf-8 编码，所以字体乱码！
-    // SDL_Surface* surface = TTF_RenderText_Solid(game->font, text, color);
-    // if (!surface) return;
-
-    // 使用 UTF-8 编码渲染文本
-    SDL_Surface* surface = TTF_RenderUTF8_Solid(game->font, text, color);
-    if (!surface) {
-        // 如果UTF-8失败，尝试使用默认编码
-        surface = TTF_RenderText_Solid(game->font, text, color);
-        if (!surface) {
-            printf("文本渲染失败: %s\n", TTF_GetError());
-            return;
-        }
+// 解码为格子数组（从尾到头），返回节数
+// 分三遍处理：展开方向、前缀和、穿墙取模。环形位数组在字边界回绕，
+// 所以最多分成两段连续展开；只有前缀和是串行的，取模一遍可以向量化
+int packed_decode(const PackedSnake* ps, Uint16* cells) {
+    Sint16 xs[PACKED_DECODE_SLOTS];
+    Sint16 ys[PACKED_DECODE_SLOTS];
+    int dirs = ps->length - 1;
+    int end = ps->start + dirs;
+    int first_end = end < PACKED_CAPACITY ? end : PACKED_CAPACITY;
+    int first_slots = (first_end + 3) / 4 * 4 - ps->start / 4 * 4;
+
+    // 展开方向，回绕的部分接在后面
+    packed_expand_run(ps->words, ps->start, first_end, xs, ys);
+    packed_expand_run(ps->words, 0, end - first_end, xs + first_slots, ys + first_slots);
+
+    // 前缀和得到未取模的坐标；加上偏置保证始终为正
+    Sint16* dx = xs + ps->start % 4;
+    Sint16* dy = ys + ps->start % 4;
+    int x = ps->tail % GRID_WIDTH + PACKED_WRAP_BIAS_X;
+    int y = ps->tail / GRID_WIDTH + PACKED_WRAP_BIAS_Y;
+    for (int i = 0; i < dirs; i++) {
+        x += dx[i];
+        y += dy[i];
+        dx[i] = (Sint16)x;
+        dy[i] = (Sint16)y;
     }
 
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(game->renderer, surface);
-    if (!texture) {
-        SDL_FreeSurface(surface);
-        return;
+    // 穿墙取模，生成格子编号
+    cells[0] = ps->tail;
+    for (int i = 0; i < dirs; i++) {
+        cells[i + 1] = (Uint16)((dy[i] % GRID_HEIGHT) * GRID_WIDTH + dx[i] % GRID_WIDTH);
     }
 
-    SDL_Rect rect = {x, y, surface->w, surface->h};
-    SDL_RenderCopy(game->renderer, texture, NULL, &rect);
-
-    SDL_DestroyTexture(texture);
-    SDL_FreeSurface(surface);
+    return ps->length;
 }
 
+// 从链表蛇身编码
+void packed_from_snake(PackedSnake* ps, const Snake* snake) {
+    Uint16 cells[GRID_CELLS];
+    SnakeNode* current = snake->head;
+    int n = 0;
 
-// 清理资源
-void cleanup(Game* game) {
-    // 清理蛇身链表
+    while (current && n < GRID_CELLS) {
+        cells[n++] = current->y * GRID_WIDTH + current->x;
+        current = current->next;
+    }
+
+    // 链表从头到尾，编码从尾到头
+    packed_init(ps, cells[n - 1]);
+    for (int i = n - 2; i >= 0; i--) {
+        packed_push_head(ps, direction_between(cells[i + 1] % GRID_WIDTH, cells[i + 1] / GRID_WIDTH,
+                                               cells[i] % GRID_WIDTH, cells[i] / GRID_WIDTH));
+    }
+}
+
+// 序列化：尾部格子(2字节) + 节数(2字节) + 每字节4个方向，返回写入的字节数
+int packed_serialize(const PackedSnake* ps, Uint8* out) {
+    int dirs = ps->length - 1;
+    int dir_bytes = (dirs + 3) / 4;
+
+    out[0] = ps->tail & 0xFF;
+    out[1] = ps->tail >> 8;
+    out[2] = ps->length & 0xFF;
+    out[3] = ps->length >> 8;
+    memset(out + PACKED_HEADER_BYTES, 0, dir_bytes);
+
+    for (int i = 0; i < dirs; i++) {
+        int pos = (ps->start + i) & PACKED_MASK;
+        int dir = (int)((ps->words[pos / 32] >> ((pos % 32) * 2)) & 3);
+        out[PACKED_HEADER_BYTES + i / 4] |= dir << ((i % 4) * 2);
+    }
+
+    return PACKED_HEADER_BYTES + dir_bytes;
+}
+
+// 从 packed_serialize 的输出恢复，返回读取的字节数
+int packed_deserialize(PackedSnake* ps, const Uint8* in) {
+    int length = in[2] | (in[3] << 8);
+
+    packed_init(ps, in[0] | (in[1] << 8));
+    for (int i = 0; i < length - 1; i++) {
+        packed_push_head(ps, (Direction)((in[PACKED_HEADER_BYTES + i / 4] >> ((i % 4) * 2)) & 3));
+    }
+
+    return PACKED_HEADER_BYTES + (length + 2) / 4;
+}
+
+// 对比链表和紧凑编码的内存占用、遍历和移动速度，并校验各种转换（--bench-packed）
+void bench_packed(void) {
+    const int lengths[] = {16, 128, 1000};
+    Uint16 cells[PACKED_CAPACITY];
+    Uint16 list_cells[PACKED_CAPACITY];
+
+    srand(1);
+    printf("紧凑蛇身编码基准测试（每组共 %d 节，链表节点交错分配以模拟长时间运行后的内存碎片）\n",
+           PACKED_BENCH_SEGMENTS);
+
+    for (int k = 0; k < (int)(sizeof(lengths) / sizeof(lengths[0])); k++) {
+        int length = lengths[k];
+        int count = PACKED_BENCH_SEGMENTS / length;
+        int move_count = count * PACKED_BENCH_MOVES;
+        SnakeNode** heads = (SnakeNode**)malloc(count * sizeof(SnakeNode*));
+        SnakeNode** tails = (SnakeNode**)malloc(count * sizeof(SnakeNode*));
+        PackedSnake* packed = (PackedSnake*)malloc(count * sizeof(PackedSnake));
+        Direction* dirs = (Direction*)malloc(count * sizeof(Direction));
+        Direction* moves = (Direction*)malloc(move_count * sizeof(Direction));
+        Uint8* arena = (Uint8*)malloc((size_t)count * (PACKED_HEADER_BYTES + PACKED_CAPACITY / 4));
+        if (!heads || !tails || !packed || !dirs || !moves || !arena) {
+            printf("内存分配失败！\n");
+            exit(1);
+        }
+
+        // 生成随机蛇身：每一轮给所有状态各加一节，链表节点因此散布在整个堆上
+        for (int j = 0; j < length; j++) {
+            for (int s = 0; s < count; s++) {
+                if (j == 0) {
+                    packed_init(&packed[s], rand() % GRID_CELLS);
+                    dirs[s] = (Direction)(rand() % 4);
+                    heads[s] = NULL;
+                } else {
+                    Direction dir = (Direction)(rand() % 4);
+                    if ((dir ^ 1) == dirs[s]) dir = dirs[s];  // 不能反向（UP/DOWN、LEFT/RIGHT 只差最低位）
+                    packed_push_head(&packed[s], dir);
+                    dirs[s] = dir;
+                }
+
+                SnakeNode* node = (SnakeNode*)malloc(sizeof(SnakeNode));
+                if (!node) {
+                    printf("内存分配失败！\n");
+                    exit(1);
+                }
+                node->x = packed[s].head % GRID_WIDTH;
+                node->y = packed[s].head / GRID_WIDTH;
+                node->next = heads[s];
+                heads[s] = node;
+                if (j == 0) tails[s] = node;
+            }
+        }
+
+        // 预先生成移动方向，两种表示走完全相同的路线
+        for (int m = 0; m < move_count; m++) {
+            Direction prev = m < count ? dirs[m % count] : moves[m - count];
+            Direction dir = (Direction)(rand() % 4);
+            moves[m] = (dir ^ 1) == prev ? prev : dir;
+        }
+
+        double freq = (double)SDL_GetPerformanceFrequency();
+
+        // 遍历链表
+        Uint64 start = SDL_GetPerformanceCounter();
+        Uint64 list_sum = 0;
+        for (int s = 0; s < count; s++) {
+            SnakeNode* current = heads[s];
+            while (current) {
+                list_sum += current->y * GRID_WIDTH + current->x;
+                current = current->next;
+            }
+        }
+        double list_ns = (SDL_GetPerformanceCounter() - start) * 1e9 / freq / PACKED_BENCH_SEGMENTS;
+
+        // 解码紧凑编码
+        start = SDL_GetPerformanceCounter();
+        Uint64 packed_sum = 0;
+        for (int s = 0; s < count; s++) {
+            int n = packed_decode(&packed[s], cells);
+            for (int i = 0; i < n; i++) {
+                packed_sum += cells[i];
+            }
+        }
+        double decode_ns = (SDL_GetPerformanceCounter() - start) * 1e9 / freq / PACKED_BENCH_SEGMENTS;
+
+        // 移动：链表与 move_snake 相同（新建头部、找到倒数第二节、释放尾部）
+        start = SDL_GetPerformanceCounter();
+        for (int m = 0; m < move_count; m++) {
+            int s = m % count;
+            SnakeNode* node = (SnakeNode*)malloc(sizeof(SnakeNode));
+            if (!node) {
+                printf("内存分配失败！\n");
+                exit(1);
+            }
+            int cell = cell_step(heads[s]->y * GRID_WIDTH + heads[s]->x, moves[m]);
+            node->x = cell % GRID_WIDTH;
+            node->y = cell / GRID_WIDTH;
+            node->next = heads[s];
+            heads[s] = node;
+
+            SnakeNode* current = heads[s];
+            while (current->next != tails[s]) {
+                current = current->next;
+            }
+            free(tails[s]);
+            current->next = NULL;
+            tails[s] = current;
+        }
+        double list_move_ns = (SDL_GetPerformanceCounter() - start) * 1e9 / freq / move_count;
+
+        start = SDL_GetPerformanceCounter();
+        for (int m = 0; m < move_count; m++) {
+            packed_push_head(&packed[m % count], moves[m]);
+            packed_pop_tail(&packed[m % count]);
+        }
+        double packed_move_ns = (SDL_GetPerformanceCounter() - start) * 1e9 / freq / move_count;
+
+        // 校验：移动后两种表示一致；链表转换、序列化到存储区再读回后也一致
+        bool moves_ok = true;
+        bool convert_ok = true;
+        size_t arena_bytes = 0;
+        for (int s = 0; s < count; s++) {
+            Snake snake = {heads[s], tails[s], dirs[s], length, 0};
+            PackedSnake converted;
+            int n = 0;
+            SnakeNode* current = heads[s];
+            while (current) {
+                list_cells[length - 1 - n++] = current->y * GRID_WIDTH + current->x;
+                current = current->next;
+            }
+
+            packed_decode(&packed[s], cells);
+            moves_ok = moves_ok && memcmp(cells, list_cells, length * sizeof(Uint16)) == 0;
+
+            packed_from_snake(&converted, &snake);
+            packed_decode(&converted, cells);
+            convert_ok = convert_ok && memcmp(cells, list_cells, length * sizeof(Uint16)) == 0;
+
+            arena_bytes += packed_serialize(&packed[s], arena + arena_bytes);
+        }
+
+        bool arena_ok = true;
+        size_t offset = 0;
+        for (int s = 0; s < count; s++) {
+            PackedSnake restored;
+            offset += packed_deserialize(&restored, arena + offset);
+            packed_decode(&restored, list_cells);
+            packed_decode(&packed[s], cells);
+            arena_ok = arena_ok && memcmp(cells, list_cells, length * sizeof(Uint16)) == 0;
+        }
+        arena_ok = arena_ok && offset == arena_bytes;
+
+        double list_bytes = sizeof(Snake) + (double)length * (sizeof(SnakeNode) + MALLOC_OVERHEAD);
+        double packed_bytes = sizeof(PackedSnake);
+        double stored_bytes = (double)arena_bytes / count;
+        double gib = 1024.0 * 1024.0 * 1024.0;
+
+        printf("长度 %d，%d 个状态:\n", length, count);
+        printf("  每状态字节: 链表 %.0f | 存储格式(序列化) %.1f (%.1fx) | 工作结构 %.0f (%.1fx)\n",
+               list_bytes, stored_bytes, list_bytes / stored_bytes, packed_bytes, list_bytes / packed_bytes);
+        printf("  每 GiB 状态数: 链表 %.0f | 存储格式 %.0f | 工作结构 %.0f\n",
+               gib / list_bytes, gib / stored_bytes, gib / packed_bytes);
+        printf("  每节耗时: 链表遍历 %.2f ns | 解码 %.2f ns（校验%s）\n",
+               list_ns, decode_ns, list_sum == packed_sum ? "一致" : "不一致！");
+        printf("  每次移动: 链表 %.2f ns | 紧凑 %.2f ns（校验%s）\n",
+               list_move_ns, packed_move_ns, moves_ok ? "一致" : "不一致！");
+        printf("  链表转换%s，存储区往返%s\n",
+               convert_ok ? "一致" : "不一致！", arena_ok ? "一致" : "不一致！");
+
+        for (int s = 0; s < count; s++) {
+            free_snake_nodes(heads[s]);
+        }
+        free(heads);
+        free(tails);
+        free(packed);
+        free(dirs);
+        free(moves);
+        free(arena);
+    }
+}
+
+// ===================== 离屏视频导出 =====================
+
+// 简单的自动驾驶：优先朝食物走，避开下一步会撞上的身体
+Direction autopilot_direction(Game* game) {
+    SnakeNode* head = game->snake.head;
+    int head_cell = head->y * GRID_WIDTH + head->x;
+    int candidates[7] = {-1, -1, game->snake.direction, DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT};
+
+    if (game->food.x > head->x) candidates[0] = DIR_RIGHT;
+    if (game->food.x < head->x) candidates[0] = DIR_LEFT;
+    if (game->food.y > head->y) candidates[1] = DIR_DOWN;
+    if (game->food.y < head->y) candidates[1] = DIR_UP;
+
+    for (int i = 0; i < 7; i++) {
+        int dir = candidates[i];
+
+        // 不能反向（UP/DOWN、LEFT/RIGHT 只差最低位）
+        if (dir < 0 || (dir ^ 1) == (int)game->snake.direction) {
+            continue;
+        }
+
+        int next = cell_step(head_cell, (Direction)dir);
+        bool blocked = false;
+        SnakeNode* current = head->next;
+        while (current) {
+            if (current->y * GRID_WIDTH + current->x == next) {
+                blocked = true;
+                break;
+            }
+            current = current->next;
+        }
+
+        if (!blocked) {
+            return (Direction)dir;
+        }
+    }
+
+    return game->snake.direction;
+}
+
+// 解析导出参数，没有 --export 时返回 false
+//   --export <局数>          导出若干局自动驾驶的对局
+//   --export-frames <帧数>   每局最多导出的帧数
+//   --export-threads <线程>  工作线程数，默认等于CPU核数
+//   --export-seed <种子>     第 i 局使用 种子 + i
+//   --export-dir <目录>      输出目录
+//   --telemetry <文件>       统计所有导出对局，定期写出 CSV 快照
+bool parse_export_args(ExportJob* job, int argc, char* argv[]) {
+    bool enabled = false;
+
+    job->games = 0;
+    job->frames = EXPORT_DEFAULT_FRAMES;
+    job->threads = SDL_GetCPUCount();
+    job->seed = 1;
+    job->dir = ".";
+    job->telemetry_path = NULL;
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--export") == 0) {
+            job->games = atoi(argv[++i]);
+            enabled = true;
+        } else if (strcmp(argv[i], "--export-frames") == 0) {
+            job->frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--export-threads") == 0) {
+            job->threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--export-seed") == 0) {
+            job->seed = (Uint32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--export-dir") == 0) {
+            job->dir = argv[++i];
+        } else if (strcmp(argv[i], "--telemetry") == 0) {
+            job->telemetry_path = argv[++i];
+        }
+    }
+
+    if (job->threads > job->games) job->threads = job->games;
+    if (job->threads > EXPORT_MAX_THREADS) job->threads = EXPORT_MAX_THREADS;
+    if (job->threads < 1) job->threads = 1;
+
+    return enabled;
+}
+
+// 把 ARGB 表面转换为 YUV420（BT.601 全范围，整数运算保证结果可复现）并写入一帧
+void write_y4m_frame(FILE* file, SDL_Surface* surface, Uint8* yuv) {
+    Uint8* y_plane = yuv;
+    Uint8* u_plane = yuv + WINDOW_WIDTH * WINDOW_HEIGHT;
+    Uint8* v_plane = u_plane + (WINDOW_WIDTH / 2) * (WINDOW_HEIGHT / 2);
+
+    SDL_LockSurface(surface);
+
+    for (int y = 0; y < WINDOW_HEIGHT; y++) {
+        const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < WINDOW_WIDTH; x++) {
+            int r = (row[x] >> 16) & 0xFF;
+            int g = (row[x] >> 8) & 0xFF;
+            int b = row[x] & 0xFF;
+            y_plane[y * WINDOW_WIDTH + x] = (Uint8)((77 * r + 150 * g + 29 * b) >> 8);
+        }
+    }
+
+    // 色度按 2x2 取平均
+    for (int y = 0; y < WINDOW_HEIGHT / 2; y++) {
+        const Uint32* row0 = (const Uint32*)((const Uint8*)surface->pixels + (y * 2) * surface->pitch);
+        const Uint32* row1 = (const Uint32*)((const Uint8*)surface->pixels + (y * 2 + 1) * surface->pitch);
+        for (int x = 0; x < WINDOW_WIDTH / 2; x++) {
+            Uint32 p[4] = {row0[x * 2], row0[x * 2 + 1], row1[x * 2], row1[x * 2 + 1]};
+            int r = 0, g = 0, b = 0;
+            for (int i = 0; i < 4; i++) {
+                r += (p[i] >> 16) & 0xFF;
+                g += (p[i] >> 8) & 0xFF;
+                b += p[i] & 0xFF;
+            }
+            r /= 4;
+            g /= 4;
+            b /= 4;
+            u_plane[y * (WINDOW_WIDTH / 2) + x] = (Uint8)((-43 * r - 85 * g + 128 * b + 32768) >> 8);
+            v_plane[y * (WINDOW_WIDTH / 2) + x] = (Uint8)((128 * r - 107 * g - 21 * b + 32768) >> 8);
+        }
+    }
+
+    SDL_UnlockSurface(surface);
+
+    fwrite("FRAME\n", 1, 6, file);
+    fwrite(yuv, 1, EXPORT_FRAME_BYTES, file);
+}
+
+// 模拟并导出一局，返回导出的帧数；结果只取决于种子，与线程数无关
+int export_game(ExportWorker* worker, Game* game, int index) {
+    ExportJob* job = worker->job;
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/game_%04d.y4m", job->dir, index);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        printf("无法创建文件: %s\n", path);
+        return 0;
+    }
+
+    fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", WINDOW_WIDTH, WINDOW_HEIGHT, EXPORT_FPS);
+
+    game->rng_state = (job->seed + index) * 2654435761u;
+    if (game->rng_state == 0) game->rng_state = 1;
+    game->high_score = 0;
+    reset_game(game);
+
+    int frames = 0;
+    while (frames < job->frames) {
+        if (frames > 0) {
+            game->snake.direction = autopilot_direction(game);
+            step_game(game);
+        }
+
+        fill_snapshot(game, worker->snapshot);
+        render_scene(game);
+        SDL_RenderFlush(game->renderer);
+        write_y4m_frame(file, worker->surface, worker->yuv);
+        frames++;
+
+        // 游戏结束画面也导出一帧
+        if (game->state == GAME_OVER) {
+            break;
+        }
+    }
+
+    fclose(file);
+    return frames;
+}
+
+// 导出线程：从任务计数器领取对局，直到全部完成
+int export_worker_main(void* data) {
+    ExportWorker* worker = (ExportWorker*)data;
+    ExportJob* job = worker->job;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // 每个线程一套离屏表面、渲染器和帧缓冲，所有帧复用
+    worker->surface = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    worker->yuv = (Uint8*)malloc(EXPORT_FRAME_BYTES);
+    worker->snapshot = (RenderSnapshot*)malloc(sizeof(RenderSnapshot));
+    Game* game = (Game*)calloc(1, sizeof(Game));
+    if (!worker->surface || !worker->yuv || !worker->snapshot || !game) {
+        printf("导出线程 %d 初始化失败\n", worker->index);
+        export_worker_cleanup(worker, game);
+        return 1;
+    }
+
+    game->renderer = SDL_CreateSoftwareRenderer(worker->surface);
+    if (!game->renderer) {
+        printf("软件渲染器创建失败: %s\n", SDL_GetError());
+        export_worker_cleanup(worker, game);
+        return 1;
+    }
+    game->view = worker->snapshot;
+    game->telemetry = job->telemetry_path ? telemetry_acquire_slot() : NULL;
+
+    // 字体对象不共享；FreeType 的打开/关闭需要串行
+    SDL_LockMutex(job->font_lock);
+    game->font = open_font();
+    SDL_UnlockMutex(job->font_lock);
+
+    while (true) {
+        int index = SDL_AtomicAdd(&job->next_game, 1);
+        if (index >= job->games) {
+            break;
+        }
+        worker->frames += export_game(worker, game, index);
+    }
+
+    worker->seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    export_worker_cleanup(worker, game);
+    return 0;
+}
+
+// 释放导出线程的资源（初始化中途失败时部分资源可能为 NULL），并报告该线程已结束
+void export_worker_cleanup(ExportWorker* worker, Game* game) {
+    ExportJob* job = worker->job;
+
+    if (game) {
+        free_snake_nodes(game->snake.head);
+
+        if (game->font) {
+            SDL_LockMutex(job->font_lock);
+            TTF_CloseFont(game->font);
+            SDL_UnlockMutex(job->font_lock);
+        }
+
+        if (game->renderer) {
+            text_cache_clear(game);
+            SDL_DestroyRenderer(game->renderer);
+        }
+        free(game);
+    }
+
+    if (worker->surface) {
+        SDL_FreeSurface(worker->surface);
+        worker->surface = NULL;
+    }
+    free(worker->yuv);
+    free(worker->snapshot);
+    worker->yuv = NULL;
+    worker->snapshot = NULL;
+
+    SDL_AtomicAdd(&job->finished, 1);
+}
+
+// 离屏导出视频（--export），返回是否成功
+bool run_export(ExportJob* job) {
+    ExportWorker workers[EXPORT_MAX_THREADS];
+    SDL_Thread* threads[EXPORT_MAX_THREADS];
+    int started = 0;
+
+    if (TTF_Init() < 0) {
+        printf("SDL_ttf初始化失败: %s\n", TTF_GetError());
+        return false;
+    }
+
+    job->font_lock = SDL_CreateMutex();
+    if (!job->font_lock) {
+        printf("互斥锁创建失败: %s\n", SDL_GetError());
+        TTF_Quit();
+        return false;
+    }
+    SDL_AtomicSet(&job->next_game, 0);
+    SDL_AtomicSet(&job->finished, 0);
+
+    printf("导出 %d 局（每局最多 %d 帧）到 %s，使用 %d 个线程\n",
+           job->games, job->frames, job->dir, job->threads);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < job->threads; i++) {
+        memset(&workers[i], 0, sizeof(ExportWorker));
+        workers[i].job = job;
+        workers[i].index = i;
+
+        threads[started] = SDL_CreateThread(export_worker_main, "export", &workers[i]);
+        if (!threads[started]) {
+            printf("导出线程创建失败: %s\n", SDL_GetError());
+            break;
+        }
+        started++;
+    }
+
+    // 一个线程都没有创建成功时，在主线程中导出
+    if (started == 0) {
+        workers[0].job = job;
+        workers[0].index = 0;
+        export_worker_main(&workers[0]);
+    }
+
+    // 等待导出完成，期间定期写出遥测快照，不暂停工作线程
+    Uint32 last_snapshot = SDL_GetTicks();
+    while (SDL_AtomicGet(&job->finished) < started) {
+        SDL_Delay(100);
+        if (job->telemetry_path && SDL_GetTicks() - last_snapshot >= TELEMETRY_EXPORT_INTERVAL) {
+            telemetry_write_csv(job->telemetry_path);
+            last_snapshot = SDL_GetTicks();
+        }
+    }
+
+    for (int i = 0; i < started; i++) {
+        SDL_WaitThread(threads[i], NULL);
+    }
+
+    if (job->telemetry_path) {
+        telemetry_write_csv(job->telemetry_path);
+    }
+
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    int workers_used = started > 0 ? started : 1;
+    unsigned long total = 0;
+
+    for (int i = 0; i < workers_used; i++) {
+        total += workers[i].frames;
+        printf("  线程 %d: %lu 帧，%.1f 帧/秒\n", i, workers[i].frames,
+               workers[i].seconds > 0 ? workers[i].frames / workers[i].seconds : 0.0);
+    }
+
+    printf("共导出 %lu 帧，用时 %.2f 秒：%.1f 帧/秒，每核 %.1f 帧/秒\n",
+           total, seconds, total / seconds, total / seconds / workers_used);
+
+    SDL_DestroyMutex(job->font_lock);
+    TTF_Quit();
+    return true;
+}
+
+// ===================== 遥测统计 =====================
+
+// 领取一个遥测槽，之后只有调用线程写这个槽；槽用完时返回 NULL（该线程不统计）
+TelemetrySlot* telemetry_acquire_slot(void) {
+    int index = SDL_AtomicAdd(&telemetry_registry.used, 1);
+
+    if (index >= TELEMETRY_MAX_SLOTS) {
+        printf("遥测槽已用完（最多 %d 个线程），该线程不再统计\n", TELEMETRY_MAX_SLOTS);
+        return NULL;
+    }
+
+    return &telemetry_registry.slots[index];
+}
+
+// 记录一次移动（在 step_game 中调用）
+void telemetry_record_step(Game* game) {
+    TelemetrySlot* slot = game->telemetry;
+    if (!slot) return;
+
+    slot->steps++;
+    slot->head_heatmap[game->snake.head->y * GRID_WIDTH + game->snake.head->x]++;
+    game->ticks_since_food++;
+}
+
+// 记录吃到食物，统计距上次吃到食物的帧数
+void telemetry_record_food(Game* game) {
+    TelemetrySlot* slot = game->telemetry;
+    if (!slot) return;
+
+    int bucket = game->ticks_since_food;
+    if (bucket >= TELEMETRY_FOOD_BUCKETS) bucket = TELEMETRY_FOOD_BUCKETS - 1;
+    slot->food_ticks[bucket]++;
+    game->ticks_since_food = 0;
+}
+
+// 一局结束时的分数桶和长度桶；记录和回退撤销都用这里，保证两者一致
+void telemetry_end_buckets(const Game* game, int* score_bucket, int* length_bucket) {
+    *score_bucket = game->score / 10;
+    *length_bucket = game->snake.length / TELEMETRY_LENGTH_STEP;
+    if (*score_bucket >= TELEMETRY_SCORE_BUCKETS) *score_bucket = TELEMETRY_SCORE_BUCKETS - 1;
+    if (*length_bucket >= TELEMETRY_LENGTH_BUCKETS) *length_bucket = TELEMETRY_LENGTH_BUCKETS - 1;
+}
+
+// 记录一局结束：死因、最终分数和长度
+void telemetry_record_death(Game* game, DeathCause cause) {
+    TelemetrySlot* slot = game->telemetry;
+    if (!slot) return;
+
+    int score_bucket, length_bucket;
+    telemetry_end_buckets(game, &score_bucket, &length_bucket);
+
+    slot->games++;
+    slot->deaths[cause]++;
+    slot->scores[score_bucket]++;
+    slot->lengths[length_bucket]++;
+}
+
+// 回退一帧时撤销它的统计，保证回退后重新走过的帧不会被重复计数
+void telemetry_undo_tick(Game* game, const TickDelta* delta) {
+    TelemetrySlot* slot = game->telemetry;
+    if (!slot) return;
+
+    if (delta->flags & TICK_GAME_OVER) {
+        int score_bucket, length_bucket;
+        telemetry_end_buckets(game, &score_bucket, &length_bucket);
+
+        slot->games--;
+        slot->deaths[delta->flags >> TICK_CAUSE_SHIFT]--;
+        slot->scores[score_bucket]--;
+        slot->lengths[length_bucket]--;
+    }
+
+    if (delta->flags & TICK_ATE) {
+        int bucket = delta->food_gap + 1;
+        if (bucket >= TELEMETRY_FOOD_BUCKETS) bucket = TELEMETRY_FOOD_BUCKETS - 1;
+        slot->food_ticks[bucket]--;
+    }
+
+    slot->steps--;
+    slot->head_heatmap[delta->head]--;
+    game->ticks_since_food = delta->food_gap;
+}
+
+// 前进（重做）一帧时重新记录统计，蛇身和分数已经恢复到这一帧之后
+void telemetry_redo_tick(Game* game, const TickDelta* delta) {
+    telemetry_record_step(game);
+    if (delta->flags & TICK_ATE) {
+        telemetry_record_food(game);
+    }
+    if (delta->flags & TICK_GAME_OVER) {
+        telemetry_record_death(game, (DeathCause)(delta->flags >> TICK_CAUSE_SHIFT));
+    }
+}
+
+// 合并所有槽。读取时不加锁，其他线程可能正在累加，
+// 结果是某一时刻附近的近似快照（计数器对齐存放，不会读到撕裂的值）
+void telemetry_merge(TelemetrySlot* merged) {
+    int used = SDL_AtomicGet(&telemetry_registry.used);
+    if (used > TELEMETRY_MAX_SLOTS) used = TELEMETRY_MAX_SLOTS;
+
+    memset(merged, 0, sizeof(TelemetrySlot));
+
+    for (int i = 0; i < used; i++) {
+        const TelemetrySlot* slot = &telemetry_registry.slots[i];
+
+        merged->steps += slot->steps;
+        merged->games += slot->games;
+        for (int k = 0; k < GRID_CELLS; k++) merged->head_heatmap[k] += slot->head_heatmap[k];
+        for (int k = 0; k < TELEMETRY_FOOD_BUCKETS; k++) merged->food_ticks[k] += slot->food_ticks[k];
+        for (int k = 0; k < DEATH_CAUSES; k++) merged->deaths[k] += slot->deaths[k];
+        for (int k = 0; k < TELEMETRY_SCORE_BUCKETS; k++) merged->scores[k] += slot->scores[k];
+        for (int k = 0; k < TELEMETRY_LENGTH_BUCKETS; k++) merged->lengths[k] += slot->lengths[k];
+    }
+}
+
+// 合并并写出 CSV 快照（列：类别,键1,键2,计数），只输出非零项
+bool telemetry_write_csv(const char* path) {
+    static const char* cause_names[DEATH_CAUSES] = {"self", "wall", "board_full"};
+    TelemetrySlot merged;
+
+    telemetry_merge(&merged);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        printf("无法写入遥测文件: %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "section,key_a,key_b,count\n");
+    fprintf(file, "steps,,,%llu\n", (unsigned long long)merged.steps);
+    fprintf(file, "games,,,%llu\n", (unsigned long long)merged.games);
+
+    // 每种死因都输出一行（即使为0），列表不随玩法设置变化；
+    // 目前棋盘四边相通，wall 始终为0
+    for (int k = 0; k < DEATH_CAUSES; k++) {
+        fprintf(file, "death,%s,,%llu\n", cause_names[k], (unsigned long long)merged.deaths[k]);
+    }
+
+    for (int k = 0; k < GRID_CELLS; k++) {
+        if (merged.head_heatmap[k]) {
+            fprintf(file, "head,%d,%d,%llu\n", k % GRID_WIDTH, k / GRID_WIDTH,
+                    (unsigned long long)merged.head_heatmap[k]);
+        }
+    }
+
+    // 最后一个桶包含所有更大的值
+    for (int k = 0; k < TELEMETRY_FOOD_BUCKETS; k++) {
+        if (merged.food_ticks[k]) {
+            fprintf(file, "food_ticks,%d,,%llu\n", k, (unsigned long long)merged.food_ticks[k]);
+        }
+    }
+
+    for (int k = 0; k < TELEMETRY_SCORE_BUCKETS; k++) {
+        if (merged.scores[k]) {
+            fprintf(file, "score,%d,,%llu\n", k * 10, (unsigned long long)merged.scores[k]);
+        }
+    }
+
+    for (int k = 0; k < TELEMETRY_LENGTH_BUCKETS; k++) {
+        if (merged.lengths[k]) {
+            fprintf(file, "length,%d,,%llu\n", k * TELEMETRY_LENGTH_STEP,
+                    (unsigned long long)merged.lengths[k]);
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+// 对比开启和关闭遥测时的模拟速度（--bench-telemetry <步数>）
+void bench_telemetry(int steps) {
+    Game* game = (Game*)calloc(1, sizeof(Game));
+    TelemetrySlot* slot = telemetry_acquire_slot();
+    double best[2] = {0.0, 0.0};
+
+    if (!game) {
+        printf("内存分配失败！\n");
+        exit(1);
+    }
+
+    // 关闭/开启交替运行，各取最快的一轮；两种情况下模拟的对局完全相同
+    for (int pass = 0; pass < TELEMETRY_BENCH_ROUNDS * 2; pass++) {
+        game->telemetry = (pass % 2) ? slot : NULL;
+        game->rng_state = 12345;
+        game->high_score = 0;
+        reset_game(game);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+
+        for (int i = 0; i < steps; i++) {
+            // 直接朝食物走，不做避让，让对局足够多样
+            SnakeNode* head = game->snake.head;
+            Direction dir;
+            if (game->food.x != head->x) {
+                dir = game->food.x > head->x ? DIR_RIGHT : DIR_LEFT;
+            } else {
+                dir = game->food.y > head->y ? DIR_DOWN : DIR_UP;
+            }
+            if ((dir ^ 1) != game->snake.direction) {
+                game->snake.direction = dir;
+            }
+
+            step_game(game);
+            if (game->state == GAME_OVER) {
+                reset_game(game);
+            }
+        }
+
+        double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        double rate = steps / seconds;
+        if (rate > best[pass % 2]) best[pass % 2] = rate;
+    }
+
+    printf("遥测开销基准测试（%d 步）:\n", steps);
+    printf("  关闭遥测: %.2f 百万步/秒\n", best[0] / 1e6);
+    printf("  开启遥测: %.2f 百万步/秒\n", best[1] / 1e6);
+    printf("  开销: %.2f%%\n", (best[0] / best[1] - 1.0) * 100.0);
+
+    free_snake_nodes(game->snake.head);
+    free(game);
+}
+
+// ===================== 模拟线程 =====================
+
+// 写入一条输入命令（主线程），队列满时丢弃
+bool input_push(InputQueue* queue, InputCommand command, Uint64 stamp) {
+    int head = SDL_AtomicGet(&queue->head);
+    int tail = SDL_AtomicGet(&queue->tail);
+
+    if (head - tail >= INPUT_QUEUE_SIZE) {
+        return false;
+    }
+
+    InputEvent* event = &queue->events[head & (INPUT_QUEUE_SIZE - 1)];
+    event->command = command;
+    event->stamp = stamp;
+
+    // 先写完数据，再让消费者看到新位置
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->head, head + 1);
+    return true;
+}
+
+// 读取一条输入命令（模拟线程）
+bool input_pop(InputQueue* queue, InputEvent* event) {
+    int tail = SDL_AtomicGet(&queue->tail);
+    int head = SDL_AtomicGet(&queue->head);
+
+    if (tail == head) {
+        return false;
+    }
+
+    SDL_MemoryBarrierAcquire();
+    *event = queue->events[tail & (INPUT_QUEUE_SIZE - 1)];
+
+    // 读完之后才把槽位还给生产者
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->tail, tail + 1);
+    return true;
+}
+
+// 把当前状态写入后台槽，再与中间槽交换（模拟线程）
+void publish_snapshot(Game* game) {
+    SnapshotBuffer* sb = &game->snapshots;
+
+    fill_snapshot(game, &sb->slots[sb->back]);
+
+    SDL_MemoryBarrierRelease();
+    sb->back = SDL_AtomicSet(&sb->middle, sb->back | SNAPSHOT_DIRTY) & ~SNAPSHOT_DIRTY;
+}
+
+// 把当前游戏状态复制到快照
+void fill_snapshot(Game* game, RenderSnapshot* snap) {
     SnakeNode* current = game->snake.head;
-    while (current) {
-        SnakeNode* next = current->next;
-        free(current);
-        current = next;
+    int length = 0;
+
+    while (current && length < GRID_CELLS) {
+        snap->cells[length++] = current->y * GRID_WIDTH + current->x;
+        current = current->next;
+    }
+
+    snap->length = length;
+    snap->food = game->food;
+    snap->state = game->state;
+    snap->score = game->score;
+    snap->high_score = game->high_score;
+    snap->speed = game->speed;
+    snap->rewind_redo = game->rewind.redo;
+    snap->input_stamp = game->last_input_stamp;
+}
+
+// 如果有新快照，用自己的槽换回中间槽（渲染线程）
+void acquire_snapshot(Game* game) {
+    SnapshotBuffer* sb = &game->snapshots;
+    Uint64 deadline = SDL_GetPerformanceCounter() + SDL_GetPerformanceFrequency() * 3 / 1000;
+
+    // 本帧刚读取了输入时，最多等待3ms让模拟线程处理完，避免输入晚一帧显示
+    while (true) {
+        if (SDL_AtomicGet(&sb->middle) & SNAPSHOT_DIRTY) {
+            sb->front = SDL_AtomicSet(&sb->middle, sb->front) & ~SNAPSHOT_DIRTY;
+            SDL_MemoryBarrierAcquire();
+        }
+
+        game->view = &sb->slots[sb->front];
+
+        if (!game->threaded ||
+            game->view->input_stamp == game->last_pushed_stamp ||
+            SDL_GetPerformanceCounter() >= deadline) {
+            break;
+        }
+        SDL_Delay(1);
+    }
+}
+
+// 处理积压的输入并推进游戏，状态有变化时发布快照
+void sim_poll(Game* game) {
+    InputEvent event;
+    bool changed = false;
+
+    while (input_pop(&game->input, &event)) {
+        apply_input(game, &event);
+        changed = true;
+    }
+
+    if (update_game(game)) {
+        changed = true;
+    }
+
+    if (changed) {
+        publish_snapshot(game);
+    }
+}
+
+// 模拟线程入口：以 1ms 的粒度轮询，不受渲染和垂直同步影响
+int sim_thread_main(void* data) {
+    Game* game = (Game*)data;
+
+    while (SDL_AtomicGet(&game->sim_running)) {
+        sim_poll(game);
+        SDL_Delay(1);
+    }
+
+    return 0;
+}
+
+// 启动模拟线程，失败时退回单线程模式
+void start_simulation(Game* game) {
+    if (!game->threaded) {
+        return;
+    }
+
+    SDL_AtomicSet(&game->sim_running, 1);
+    game->sim_thread = SDL_CreateThread(sim_thread_main, "simulation", game);
+
+    if (!game->sim_thread) {
+        printf("模拟线程创建失败，改为单线程运行: %s\n", SDL_GetError());
+        SDL_AtomicSet(&game->sim_running, 0);
+        game->threaded = false;
+    }
+}
+
+// 停止并等待模拟线程退出
+void stop_simulation(Game* game) {
+    if (!game->sim_thread) {
+        return;
+    }
+
+    SDL_AtomicSet(&game->sim_running, 0);
+    SDL_WaitThread(game->sim_thread, NULL);
+    game->sim_thread = NULL;
+}
+
+// 解析命令行参数
+//   --single-thread     在主线程中模拟（改动前的运行方式，用于对比）
+//   --render-load <ms>  每帧额外增加的渲染耗时，模拟高负载渲染
+//   --telemetry <path>  统计游戏数据，定期写出 CSV 快照
+void parse_args(Game* game, int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--single-thread") == 0) {
+            game->threaded = false;
+        } else if (strcmp(argv[i], "--render-load") == 0 && i + 1 < argc) {
+            game->render_load = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            game->telemetry_path = argv[++i];
+            game->telemetry = telemetry_acquire_slot();
+        }
+    }
+}
+
+// 打印帧抖动和输入延迟统计
+void print_frame_stats(Game* game) {
+    FrameStats* stats = &game->stats;
+
+    printf("帧时统计（%s，渲染负载 %d ms）:\n",
+           game->threaded ? "独立模拟线程" : "单线程", game->render_load);
+
+    if (stats->ticks > 0) {
+        printf("  帧抖动: 平均 %.2f ms，最大 %.2f ms（%lu 帧）\n",
+               stats->jitter_sum / stats->ticks, stats->jitter_max, stats->ticks);
+    }
+
+    if (stats->inputs > 0) {
+        printf("  输入到显示延迟: 平均 %.2f ms，最大 %.2f ms（%lu 次）\n",
+               stats->latency_sum / stats->inputs, stats->latency_max, stats->inputs);
+    }
+}
+
+// 渲染游戏
+void render_game(Game* game) {
+    // 取最新发布的快照，之后的绘制都只读取 game->view
+    acquire_snapshot(game);
+
+    // 绘制画面
+    render_scene(game);
+
+    // 模拟高负载渲染（--render-load）
+    if (game->render_load > 0) {
+        SDL_Delay(game->render_load);
+    }
+
+    // 显示渲染结果
+    SDL_RenderPresent(game->renderer);
+
+    // 新输入第一次被呈现时，统计输入到显示的延迟
+    if (game->view->input_stamp != game->stats.last_input_stamp) {
+        double ms = (double)(SDL_GetPerformanceCounter() - game->view->input_stamp) * 1000.0 / SDL_GetPerformanceFrequency();
+        game->stats.latency_sum += ms;
+        if (ms > game->stats.latency_max) game->stats.latency_max = ms;
+        game->stats.inputs++;
+        game->stats.last_input_stamp = game->view->input_stamp;
+    }
+}
+
+// 绘制整个画面（不含呈现），窗口和离屏导出共用
+void render_scene(Game* game) {
+    // 清屏
+    SDL_SetRenderDrawColor(game->renderer, COLOR_BACKGROUND);
+    SDL_RenderClear(game->renderer);
+
+    // 绘制网格
+    render_grid(game);
+
+    // 绘制蛇
+    render_snake(game);
+
+    // 绘制食物
+    render_food(game);
+
+    // 绘制UI
+    render_ui(game);
+}
+
+// 绘制网格
+void render_grid(Game* game) {
+    SDL_SetRenderDrawColor(game->renderer, COLOR_GRID);
+
+    // 绘制垂直线
+    for (int x = 0; x <= WINDOW_WIDTH; x += GRID_SIZE) {
+        SDL_RenderDrawLine(game->renderer, x, 0, x, WINDOW_HEIGHT - 100);
     }
 
-    // 清理字体
+    // 绘制水平线
+    for (int y = 0; y <= WINDOW_HEIGHT - 100; y += GRID_SIZE) {
+        SDL_RenderDrawLine(game->renderer, 0, y, WINDOW_WIDTH, y);
+    }
+}
+
+// 绘制蛇
+void render_snake(Game* game) {
+    const RenderSnapshot* view = game->view;
+
+    for (int index = 0; index < view->length; index++) {
+        SDL_Rect rect = {
+            (view->cells[index] % GRID_WIDTH) * GRID_SIZE,
+            (view->cells[index] / GRID_WIDTH) * GRID_SIZE,
+            GRID_SIZE,
+            GRID_SIZE
+        };
+
+        // 蛇头用不同颜色
+        if (index == 0) {
+            SDL_SetRenderDrawColor(game->renderer, COLOR_SNAKE_HEAD);
+        } else {
+            SDL_SetRenderDrawColor(game->renderer, COLOR_SNAKE_BODY);
+        }
+
+        SDL_RenderFillRect(game->renderer, &rect);
+    }
+}
+
+// 绘制食物
+void render_food(Game* game) {
+    const Food* food = &game->view->food;
+    SDL_Rect rect = {
+        food->x * GRID_SIZE,
+        food->y * GRID_SIZE,
+        GRID_SIZE,
+        GRID_SIZE
+    };
+
+    SDL_SetRenderDrawColor(game->renderer, COLOR_FOOD);
+    SDL_RenderFillRect(game->renderer, &rect);
+
+    // 绘制食物内部的小矩形，使其看起来更像苹果
+    SDL_SetRenderDrawColor(game->renderer, 0xFF, 0xCC, 0xCC, 0xFF);
+    SDL_Rect inner_rect = {
+        food->x * GRID_SIZE + 4,
+        food->y * GRID_SIZE + 4,
+        GRID_SIZE - 8,
+        GRID_SIZE - 8
+    };
+    SDL_RenderFillRect(game->renderer, &inner_rect);
+}
+
+// 绘制UI
+void render_ui(Game* game) {
+    const RenderSnapshot* view = game->view;
+    SDL_Color text_color = {COLOR_TEXT};
+
+    // 绘制分数区域背景
+    SDL_Rect score_rect = {0, WINDOW_HEIGHT - 100, WINDOW_WIDTH, 100};
+    SDL_SetRenderDrawColor(game->renderer, 0x25, 0x25, 0x25, 0xFF);
+    SDL_RenderFillRect(game->renderer, &score_rect);
+
+    // 绘制分数
+    char score_text[100];
+    snprintf(score_text, sizeof(score_text), "分数: %d", view->score);
+    render_text(game, score_text, 20, WINDOW_HEIGHT - 80, text_color);
+
+    // 绘制最高分
+    snprintf(score_text, sizeof(score_text), "最高分: %d", view->high_score);
+    render_text(game, score_text, 20, WINDOW_HEIGHT - 50, text_color);
+
+    // 绘制速度/等级
+    snprintf(score_text, sizeof(score_text), "速度: %d", (160 - view->speed) / 10);
+    render_text(game, score_text, WINDOW_WIDTH - 200, WINDOW_HEIGHT - 80, text_color);
+
+    // 绘制操作提示
+    snprintf(score_text, sizeof(score_text), "Tips: 方向键移动 | SPACE 暂停 | R 重新开始 | ESC 退出");
+    render_text(game, score_text, WINDOW_WIDTH/2 - 250, WINDOW_HEIGHT - 30, text_color);
+
+    // 根据游戏状态显示不同信息
+    switch (view->state) {
+        case GAME_START:
+            render_text(game, "贪吃蛇游戏", WINDOW_WIDTH/2 - 100, 100, text_color);
+            render_text(game, "按 SPACE 或 Enter 开始游戏", WINDOW_WIDTH/2 - 150, 150, text_color);
+            break;
+
+        case GAME_PAUSED:
+            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 128);
+            SDL_Rect overlay = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
+            SDL_RenderFillRect(game->renderer, &overlay);
+            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_NONE);
+
+            render_text(game, "游戏暂停", WINDOW_WIDTH/2 - 80, WINDOW_HEIGHT/2 - 50, text_color);
+            render_text(game, "按 SPACE 继续", WINDOW_WIDTH/2 - 100, WINDOW_HEIGHT/2, text_color);
+
+            snprintf(score_text, sizeof(score_text), "回放 -%u 帧 | BACKSPACE/PgUp 后退 | PgDn 前进", view->rewind_redo);
+            render_text(game, score_text, WINDOW_WIDTH/2 - 250, WINDOW_HEIGHT/2 + 40, text_color);
+            break;
+
+        case GAME_OVER:
+            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 192);
+            SDL_Rect overlay2 = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
+            SDL_RenderFillRect(game->renderer, &overlay2);
+            SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_NONE);
+
+            SDL_Color game_over_color = {COLOR_GAME_OVER};
+            render_text(game, "游戏结束!", WINDOW_WIDTH/2 - 80, WINDOW_HEIGHT/2 - 100, game_over_color);
+
+            snprintf(score_text, sizeof(score_text), "最终分数: %d", view->score);
+            render_text(game, score_text, WINDOW_WIDTH/2 - 100, WINDOW_HEIGHT/2 - 50, text_color);
+
+            render_text(game, "按 R 或 Enter 重新开始", WINDOW_WIDTH/2 - 150, WINDOW_HEIGHT/2, text_color);
+            render_text(game, "按 ESC 退出游戏", WINDOW_WIDTH/2 - 120, WINDOW_HEIGHT/2 + 40, text_color);
+            break;
+
+        case GAME_PLAYING:
+            // 游戏中不显示额外信息
+            break;
+    }
+}
+
+// 渲染文本
+// 文字纹理按内容和颜色缓存：固定的提示文字只生成一次，分数等只在数值变化时重新生成
+void render_text(Game* game, const char* text, int x, int y, SDL_Color color) {
+    if (!game->font) {
+        // 如果没有字体，绘制一个简单的矩形作为占位符
+        SDL_Rect rect = {x, y, strlen(text) * 10, 20};
+        SDL_SetRenderDrawColor(game->renderer, color.r, color.g, color.b, 255);
+        SDL_RenderDrawRect(game->renderer, &rect);
+        return;
+    }
+
+    // 查找缓存，同时记下最久未使用的条目以备替换
+    TextCacheEntry* entry = NULL;
+    TextCacheEntry* oldest = &game->text_cache[0];
+    game->text_clock++;
+    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+        TextCacheEntry* candidate = &game->text_cache[i];
+        if (candidate->texture && candidate->color.r == color.r && candidate->color.g == color.g &&
+            candidate->color.b == color.b && strcmp(candidate->text, text) == 0) {
+            entry = candidate;
+            break;
+        }
+        if (!candidate->texture || (oldest->texture && candidate->last_used < oldest->last_used)) {
+            oldest = candidate;
+        }
+    }
+
+    if (!entry) {
+        // !Error: 原来失败的方案，没有使用 utf-8 编码，所以字体乱码！
+        // SDL_Surface* surface = TTF_RenderText_Solid(game->font, text, color);
+        // if (!surface) return;
+
+        // 使用 UTF-8 编码渲染文本
+        SDL_Surface* surface = TTF_RenderUTF8_Solid(game->font, text, color);
+        if (!surface) {
+            // 如果UTF-8失败，尝试使用默认编码
+            surface = TTF_RenderText_Solid(game->font, text, color);
+            if (!surface) {
+                printf("文本渲染失败: %s\n", TTF_GetError());
+                return;
+            }
+        }
+
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(game->renderer, surface);
+        if (!texture) {
+            SDL_FreeSurface(surface);
+            return;
+        }
+
+        // 过长的文字不缓存，用完即释放
+        if (strlen(text) >= TEXT_CACHE_MAX_LEN) {
+            SDL_Rect rect = {x, y, surface->w, surface->h};
+            SDL_RenderCopy(game->renderer, texture, NULL, &rect);
+            SDL_DestroyTexture(texture);
+            SDL_FreeSurface(surface);
+            return;
+        }
+
+        entry = oldest;
+        if (entry->texture) {
+            SDL_DestroyTexture(entry->texture);
+        }
+        strcpy(entry->text, text);
+        entry->color = color;
+        entry->texture = texture;
+        entry->w = surface->w;
+        entry->h = surface->h;
+        SDL_FreeSurface(surface);
+    }
+
+    entry->last_used = game->text_clock;
+    SDL_Rect rect = {x, y, entry->w, entry->h};
+    SDL_RenderCopy(game->renderer, entry->texture, NULL, &rect);
+}
+
+// 释放缓存的文字纹理，必须在销毁渲染器之前调用
+void text_cache_clear(Game* game) {
+    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+        if (game->text_cache[i].texture) {
+            SDL_DestroyTexture(game->text_cache[i].texture);
+            game->text_cache[i].texture = NULL;
+        }
+    }
+}
+
+
+// 清理资源
+void cleanup(Game* game) {
+    // 先停止模拟线程，再释放它使用的数据
+    stop_simulation(game);
+
+    // 清理蛇身链表
+    free_snake_nodes(game->snake.head);
+
+    // 清理字体和文字纹理
+    text_cache_clear(game);
     if (game->font) {
         TTF_CloseFont(game->font);
     }
@@ -712,6 +2501,23 @@ void cleanup(Game* game) {
 // ===================== 主函数 =====================
 int main(int argc, char* argv[]) {
     Game game;
+    ExportJob export_job;
+
+    // 无界面模式：基准测试和视频导出
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench-packed") == 0) {
+            bench_packed();
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-telemetry") == 0 && i + 1 < argc) {
+            bench_telemetry(atoi(argv[i + 1]));
+            return 0;
+        }
+    }
+
+    if (parse_export_args(&export_job, argc, argv)) {
+        return run_export(&export_job) ? 0 : 1;
+    }
 
     printf("=== 贪吃蛇游戏 ===\n");
     printf("正在初始化游戏...\n");
@@ -722,29 +2528,47 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    printf("游戏初始化成功！\n");
+    parse_args(&game, argc, argv);
+    start_simulation(&game);
+
+    printf("游戏初始化成功！（%s）\n", game.threaded ? "独立模拟线程" : "单线程");
     printf("游戏控制说明：\n");
     printf("  方向键 - 控制蛇移动\n");
     printf("  SPACE - 暂停/继续\n");
     printf("  R键 - 重新开始（游戏结束后）\n");
+    printf("  BACKSPACE - 回退一帧 / PgUp 回退%d帧 / PgDn 前进%d帧\n", REWIND_SCRUB_TICKS, REWIND_SCRUB_TICKS);
     printf("  ESC键 - 退出游戏\n");
 
     // 主游戏循环
+    Uint32 last_telemetry = SDL_GetTicks();
     while (game.running) {
         // 处理输入
         handle_input(&game);
 
-        // 更新游戏逻辑
-        update_game(&game);
+        // 更新游戏逻辑（多线程时由模拟线程负责）
+        if (!game.threaded) {
+            sim_poll(&game);
+        }
 
         // 渲染游戏
         render_game(&game);
 
+        // 定期写出遥测快照（不暂停模拟线程）
+        if (game.telemetry_path && SDL_GetTicks() - last_telemetry >= TELEMETRY_EXPORT_INTERVAL) {
+            telemetry_write_csv(game.telemetry_path);
+            last_telemetry = SDL_GetTicks();
+        }
+
         // 控制帧率
         SDL_Delay(16);  // 约60FPS
     }
 
     // 清理资源
+    stop_simulation(&game);
+    print_frame_stats(&game);
+    if (game.telemetry_path) {
+        telemetry_write_csv(game.telemetry_path);
+    }
     cleanup(&game);
 
     printf("游戏结束。感谢游玩！\n");